@@ -0,0 +1,83 @@
+#ifndef ASSET_BUNDLE_H
+#define ASSET_BUNDLE_H
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <cstdint>
+
+// On-disk bundle layout (little-endian, offsets from the start of the file):
+//   BundleHeader | BundleEntry[entry_count] sorted by path | strings, heads and bodies
+// Each entry points at its URL path, ETag, a precomputed response head (status line and
+// headers, no blank line) and the body, plus an optional gzip variant with its own head.
+
+const char BUNDLE_MAGIC[8] = {'H', 'T', 'T', 'P', 'B', 'N', 'D', 'L'};
+const uint32_t BUNDLE_VERSION = 1;
+
+struct BundleHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t entry_count;
+	uint64_t entries_offset;
+	uint64_t file_size;
+};
+
+struct BundleEntry {
+	uint64_t path_offset;
+	uint64_t etag_offset;
+	uint64_t head_offset;
+	uint64_t body_offset;
+	uint64_t body_length;
+	uint64_t gzip_head_offset;
+	uint64_t gzip_body_offset;
+	uint64_t gzip_body_length;
+	uint32_t path_length;
+	uint32_t etag_length;
+	uint32_t head_length;
+	uint32_t gzip_head_length;  // 0 when there is no precompressed variant
+};
+
+static_assert(sizeof(BundleHeader) == 32, "BundleHeader layout changed");
+static_assert(sizeof(BundleEntry) == 80, "BundleEntry layout changed");
+
+// One asset resolved from the bundle; views point into the mapped file
+struct BundleAsset {
+	std::string_view etag;
+	std::string_view head;
+	std::string_view body;
+	std::string_view gzip_head;
+	std::string_view gzip_body;
+};
+
+// ETag of an entry's gzip variant: the identity ETag with "-gz" before the closing quote,
+// so a cache never takes one encoding's bytes for the other's
+std::string gzipEtag(std::string_view etag);
+
+// Read-only, memory-mapped bundle. Opening maps the file and checks only the header (O(1));
+// lookups are a binary search over the mapped path table with no allocation or I/O.
+class AssetBundle {
+public:
+	// Map and validate the bundle; returns nullptr if it is missing or malformed
+	static std::unique_ptr<AssetBundle> open(const std::string& bundle_path);
+
+	// Find a normalized URL path ("/index.html")
+	bool find(std::string_view url_path, BundleAsset& asset) const;
+
+	// Keeps the mapping alive for responses that point into it
+	const std::shared_ptr<const void>& mapping() const { return mapped; }
+
+	size_t size() const { return entry_count; }
+
+private:
+	AssetBundle() = default;
+
+	std::string_view view(uint64_t offset, uint64_t length) const;
+
+	std::shared_ptr<const void> mapped;
+	const char* base = nullptr;
+	uint64_t file_size = 0;
+	const BundleEntry* entries = nullptr;
+	size_t entry_count = 0;
+};
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <string_view>
+#include <cstddef>
+
+// Fixed-size I/O buffers shared by all connections.
+// Buffers come in three size classes. Each thread keeps a short free list per class and
+// spills to a global list (under a mutex) when it is full; anything past the global limit
+// goes back to the heap. Requests larger than the biggest class get a one-off allocation.
+
+const size_t BUFFER_SIZE_CLASSES[] = {4096, 16384, 65536};
+const size_t BUFFER_CLASS_COUNT = sizeof(BUFFER_SIZE_CLASSES) / sizeof(BUFFER_SIZE_CLASSES[0]);
+
+struct PooledBuffer {
+	char* data = nullptr;
+	size_t capacity = 0;
+};
+
+// Free buffers kept per size class: per thread, and in the global overflow list
+void configureBufferPool(size_t thread_cache_limit, size_t global_limit);
+
+// Smallest size class that fits min_capacity (or exactly min_capacity if larger than all classes)
+PooledBuffer acquireBuffer(size_t min_capacity);
+
+// Return a buffer to the pool and reset it to empty
+void releaseBuffer(PooledBuffer& buffer);
+
+// Move this thread's cached buffers to the global lists, e.g. before blocking on an idle connection
+void releaseThreadBuffers();
+
+// Growable byte buffer on pooled storage, used for connection input.
+// Bytes are appended at the back and consumed from the front; an empty buffer
+// can give its storage back with release() and picks up a new one on demand.
+class IoBuffer {
+public:
+	IoBuffer() = default;
+	~IoBuffer() { release(); }
+
+	IoBuffer(const IoBuffer&) = delete;
+	IoBuffer& operator=(const IoBuffer&) = delete;
+
+	std::string_view view() const { return std::string_view(buffer.data + start, end - start); }
+	size_t length() const { return end - start; }
+	bool empty() const { return start == end; }
+	size_t capacity() const { return buffer.capacity; }
+
+	// Make room for at least min_free more bytes without exceeding max_capacity in total.
+	// Returns false if the buffered bytes plus min_free do not fit in max_capacity.
+	bool prepare(size_t min_free, size_t max_capacity);
+
+	char* writePointer() { return buffer.data + end; }
+	size_t writable() const { return buffer.capacity - end; }
+	void commit(size_t count) { end += count; }
+
+	// Drop bytes from the front
+	void consume(size_t count);
+
+	// Give the storage back to the pool; any buffered bytes are discarded
+	void release();
+
+private:
+	PooledBuffer buffer;
+	size_t start = 0;
+	size_t end = 0;
+};
+
+#endif
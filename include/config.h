@@ -0,0 +1,63 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// A path prefix forwarded to one or more "host:port" backends
+struct ProxyRouteConfig {
+	std::string prefix;
+	std::vector<std::string> backends;
+};
+
+// A site served for one Host name ("example.com", "*.example.com" or "*" for any host)
+struct VirtualHostConfig {
+	std::string host;
+	std::string webroot;
+	std::string bundle_file;   // Optional asset bundle for this site
+};
+
+// Optional settings read from a config file at startup (port and webroot stay on the command line)
+struct ServerConfig {
+	std::string mime_types_file;  // Extra extension -> MIME mappings in mime.types format
+	std::string bundle_file;      // Serve from this asset bundle (see http_pack) instead of the webroot
+	std::vector<ProxyRouteConfig> proxy_routes;   // "proxy <prefix> <host:port> ..." lines
+	std::string proxy_balance = "least_conn";     // "least_conn" or "round_robin"
+	std::string tls_cert_file;    // PEM certificate chain; with tls_key_file the listener speaks TLS only
+	std::string tls_key_file;     // PEM private key
+	std::vector<VirtualHostConfig> virtual_hosts;  // "vhost <host> <webroot> [bundle]" lines
+	std::string default_host;     // Site for requests whose Host matches no vhost (default: the command-line webroot)
+	std::string live_prefix;      // Path prefix of WebSocket/SSE channels ("/live/"), empty disables them
+	size_t live_queue_limit = 1048576;              // Unsent bytes a live subscriber may fall behind by
+	std::string live_slow_consumer = "disconnect";  // "disconnect" or "drop" (skip messages) past the limit
+	bool uploads = false;         // Accept PUT/POST uploads and DELETE into the webroot
+	uint64_t upload_max_size = 0; // Largest accepted upload in bytes, 0 for no limit
+	size_t max_request_size = 0;       // Largest buffered request in bytes, 0 keeps the built-in 100KB
+	size_t buffer_thread_cache = 16;   // Free I/O buffers each thread keeps per size class
+	size_t buffer_global_cache = 1024; // Free I/O buffers kept globally per size class
+	int listen_backlog = 0;       // Accept queue length, 0 uses SOMAXCONN
+	bool tcp_nodelay = true;      // Disable Nagle on client connections
+	int tcp_fastopen = 0;         // TCP Fast Open queue length, 0 disables it
+	int defer_accept = 0;         // Seconds the kernel may hold a connection until its first bytes arrive (Linux)
+	int socket_rcvbuf = 0;        // SO_RCVBUF for client connections in bytes, 0 keeps the OS default
+	int socket_sndbuf = 0;        // SO_SNDBUF for client connections in bytes, 0 keeps the OS default
+	int accept_batch = 64;        // Most connections accepted per wakeup of the accept loop
+	unsigned int trace_sample_rate = 0;  // Trace one request in N, 0 disables tracing
+	std::string trace_file = "trace.json";   // Chrome trace JSON written at shutdown when tracing is on
+	size_t trace_max_events = 1000000;   // Trace events kept in memory before new ones are dropped
+	double rate_limit_requests = 0;   // Requests per second per client, 0 for no limit
+	double rate_limit_burst = 0;      // Requests a client may make at once, 0 for one second's worth
+	double rate_limit_bytes = 0;      // Response bytes per second per client, 0 for no limit
+	double rate_limit_byte_burst = 0; // Bytes a client may receive at once, 0 for one second's worth
+	int rate_limit_prefix = 32;       // Address bits that identify a client (24 limits whole /24 subnets)
+	size_t rate_limit_clients = 65536;    // Clients tracked at once; the longest idle are forgotten first
+	int handoff_port = 0;         // Loopback control port for listening-socket handoff, 0 disables it
+	std::string handoff_secret;   // Shared by old and new process; a handoff request without it is refused
+	int drain_timeout = 30;       // Seconds to let in-flight requests finish on shutdown or handoff
+};
+
+// Parse "key value" lines; '#' starts a comment. Unknown keys are reported and skipped.
+ServerConfig loadConfig(const std::string& config_path);
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef CONNECTION_HANDLER_H
+#define CONNECTION_HANDLER_H
+
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <unordered_set>
+#include <winsock2.h>
+#include "server.h"
+#include "request_parser.h"
+#include "response_builder.h"
+#include "file_handler.h"
+#include "virtual_hosts.h"
+#include "upstream_proxy.h"
+#include "tls.h"
+#include "live_hub.h"
+#include "rate_limiter.h"
+
+// State kept for one client connection across keep-alive requests
+struct Connection {
+	SOCKET socket;
+	sockaddr_in peer;           // Client address from accept()
+	TlsStream* tls = nullptr;   // Set after the handshake when the listener terminates TLS
+	IoBuffer input;      // Received bytes not yet parsed, may hold several pipelined requests
+	OutputQueue output;  // Serialized responses waiting to be flushed
+};
+
+const int KEEP_ALIVE_TIMEOUT_MS = 5000;     // Idle time before a keep-alive connection is closed
+const size_t MAX_REQUEST_SIZE = 100000;     // Default limit on a single buffered request (100KB)
+const int LINGER_CLOSE_MS = 1000;           // How long input is read and discarded after refusing a request, before closing
+const size_t LINGER_CLOSE_MAX_BYTES = 1024 * 1024;   // Most input discarded that way
+const size_t UPLOAD_CHUNK_SIZE = BUFFER_SIZE_CLASSES[BUFFER_CLASS_COUNT - 1];   // Upload bodies are received and written this much at a time
+
+// Shared state handed to every client thread
+struct ServerContext {
+	VirtualHostTable* hosts;  // Site per Host header, each with its own FileHandler
+	UpstreamProxy* proxy;   // nullptr when no proxy routes are configured
+	TlsContext* tls;        // nullptr serves plain HTTP
+	LiveHub* live = nullptr;   // WebSocket/SSE channels, nullptr when not configured
+	RateLimiter* limiter = nullptr;   // Per-client limits, nullptr when not configured
+
+	size_t max_request_size = MAX_REQUEST_SIZE;
+	bool uploads = false;           // PUT/POST bodies are stored in the site's webroot, DELETE removes files
+	uint64_t upload_max_size = 0;   // Largest accepted upload, 0 for no limit
+
+	std::atomic<int> active_connections{0};   // Client threads still running, counted by main before each thread starts
+	std::atomic<bool> draining{false};        // Set on shutdown or handoff: finish the current request, then close
+
+	std::mutex sockets_mutex{};
+	std::unordered_set<SOCKET> client_sockets{};   // Sockets of running client threads, shut down by an overdue drain
+};
+
+// Count and register a client socket before its thread starts (main's accept loop)
+void registerClient(ServerContext& context, SOCKET client_socket);
+
+// Client handler - runs in separate thread for each client, unregisters and uncounts it on exit
+void handleClient(SOCKET client_socket, const sockaddr_in& peer, ServerContext& context);
+
+// Shut down every registered client socket, forcing their threads to finish and close it
+void abortClients(ServerContext& context);
+
+// Produce the response for one parsed request
+ResponseData dispatchRequest(const RequestData& request, FileHandler& file_handler);
+
+// Answer a request from the site named by its Host header: the upload body is streamed from
+// upload_connection when set, DELETE removes a file when uploads are on, anything else goes to
+// dispatchRequest. Records the site's metrics and sets the Connection header; keep_alive is
+// cleared when the response must close the connection.
+ResponseData respondFromSite(const RequestData& request, ServerContext& context, bool& keep_alive, Connection* upload_connection = nullptr);
+
+// Append a response to the connection's output queue (headers and body as separate segments)
+void queueResponse(Connection& connection, ResponseData& response);
+
+#endif
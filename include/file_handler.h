@@ -2,20 +2,66 @@
 #define FILE_HANDLER_H
 
 #include <string>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <vector>
+#include <memory>
+#include <future>
+#include <list>
+#include <unordered_map>
+#include <cstdint>
+#include <winsock2.h>
+#include "request_parser.h"
 #include "response_builder.h"
+#include "path_index.h"
+#include "asset_bundle.h"
+
+// An upload being written: the body goes to a temp file beside the target, which
+// replaces the target only once every byte has arrived
+struct PendingUpload {
+	std::string url_path;       // Index key of the target
+	std::string file_path;      // Target under the webroot
+	std::string temp_path;      // Temp file receiving the body; cleared once moved into place or deleted
+	HANDLE file = INVALID_HANDLE_VALUE;
+	uint64_t expected = 0;      // Content-Length
+	uint64_t written = 0;
+
+	PendingUpload() = default;
+	// An upload left unfinished (e.g. by an exception) is discarded
+	~PendingUpload() { discard(); }
+
+	PendingUpload(const PendingUpload&) = delete;
+	PendingUpload& operator=(const PendingUpload&) = delete;
+
+	// Close the handle and delete the temp file, if still there
+	void discard();
+};
 
 class FileHandler {
 public:
-	FileHandler(const std::string& webroot);
+	// With a bundle_path, assets are served from the mapped bundle and the webroot is not scanned
+	FileHandler(const std::string& webroot, const std::string& bundle_path = "");
+	~FileHandler();
+
+	FileHandler(const FileHandler&) = delete;
+	FileHandler& operator=(const FileHandler&) = delete;
 
 	// Handle GET request
 	ResponseData handleGetRequest(const std::string& requested_path);
 
+	// Handle GET request with its headers (bundle mode uses Accept-Encoding and If-None-Match)
+	ResponseData handleGetRequest(const RequestData& request);
+
 	// Get file content
 	std::string readFile(const std::string& file_path);
 
-	// Check if file exists and is accessible
-	bool fileExists(const std::string& file_path);
+	// Shared, immutable file body from the cache. Concurrent misses on the same file wait
+	// for a single read instead of each reading their own copy. Throws if the read fails.
+	std::shared_ptr<const std::string> loadFile(const FileEntry& entry);
+
+	// Resolve a request path through the current index snapshot (one hash lookup, no syscalls)
+	bool resolvePath(const std::string& request_path, FileEntry& entry);
 
 	// Map request path to actual filesystem path
 	std::string mapPathToFile(const std::string& request_path);
@@ -23,8 +69,74 @@ public:
 	// Validate path (prevent directory traversal)
 	bool validateSecurityPath(const std::string& file_path);
 
+	// Rescan the webroot and publish a new index snapshot
+	void rebuildIndex();
+
+	// Start an upload of content_length bytes to request_path: creates and preallocates the temp
+	// file. Returns status 0 when the body may be written, otherwise the response to send.
+	ResponseData beginUpload(const std::string& request_path, uint64_t content_length, PendingUpload& upload);
+
+	// Append the next part of the body to the temp file
+	bool writeUpload(PendingUpload& upload, const char* data, size_t length);
+
+	// Move the complete temp file into place, then update the index and drop the cached body
+	ResponseData finishUpload(PendingUpload& upload);
+
+	// Discard an upload that did not complete; the target is left untouched
+	void abortUpload(PendingUpload& upload);
+
+	// Delete the file behind request_path and remove it from the index and cache
+	ResponseData deleteFile(const std::string& request_path);
+
 private:
+	// Serve a request straight from the mapped bundle pages
+	ResponseData serveFromBundle(const RequestData& request);
+
+	// Publish a new snapshot; the old one is freed once its last reader lets go
+	void publishIndex(std::shared_ptr<const PathIndex> index);
+
+	// Publish a copy of the current snapshot with one entry replaced, or removed when entry is
+	// nullptr, and drop only that file's cached body
+	void updateIndexEntry(const std::string& url_path, const FileEntry* entry);
+
+	// Index key for a path about to be written or deleted, with each segment that already exists
+	// spelled as on disk: "/Docs/A.txt" writes "docs/a.txt" on a case-insensitive volume
+	std::string diskCaseUrlPath(const std::string& url_path);
+
+	// Drop one cached body and its recency entry; cache_mutex must be held
+	void eraseCachedFile(const std::string& file_path);
+
+	// Background thread: rebuild the index whenever the webroot changes
+	void watchWebroot();
+
 	std::string webroot;  // Root directory for serving files
+
+	// RCU-style snapshot, only ever accessed with std::atomic_load/atomic_store. Readers hold a
+	// reference for the length of one lookup, so a replaced snapshot lives exactly as long as needed.
+	std::shared_ptr<const PathIndex> current_index;
+	std::mutex publish_mutex;  // Serializes writers only
+
+	std::atomic<bool> watching;
+	std::thread watcher_thread;
+
+	std::unique_ptr<AssetBundle> bundle;  // Set in bundle mode
+
+	// File body cache keyed by resolved file path. An entry is inserted by the first request
+	// that misses and holds a future the others wait on; size and mtime identify the version.
+	// cache_lru orders the paths most recently used first; the budget evicts from its back.
+	struct CachedFile {
+		uintmax_t size;
+		std::filesystem::file_time_type mtime;
+		std::shared_future<std::shared_ptr<const std::string>> body;
+		unsigned long long load_id;   // Tells the loading thread whether the entry is still its own
+		std::list<std::string>::iterator lru_position;
+	};
+	std::unordered_map<std::string, CachedFile> file_cache;
+	std::list<std::string> cache_lru;
+	uintmax_t file_cache_bytes = 0;
+	unsigned long long next_load_id = 0;
+	std::mutex cache_mutex;
+
 };
 
 #endif
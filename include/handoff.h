@@ -0,0 +1,32 @@
+#ifndef HANDOFF_H
+#define HANDOFF_H
+
+#include <string>
+#include <winsock2.h>
+
+// Listening-socket handoff for zero-downtime restarts.
+//
+// A running server listens on 127.0.0.1:<handoff_port>. A newly started server first
+// connects there and sends its process id and the configured secret; the running one
+// checks the secret, that the connection really comes from that process, and that the
+// process runs the same executable as the same user. It then duplicates its listening
+// socket into the new process (WSADuplicateSocket) and replies with the protocol info.
+// Once the new process confirms, the old one stops accepting and drains, while the
+// shared accept queue keeps every pending connection for the new process.
+
+const int HANDOFF_TIMEOUT_MS = 2000;          // Per-step timeout on the control connection
+const int HANDOFF_BIND_RETRY_MS = 2000;       // How long a new process waits for the old control port
+const size_t HANDOFF_MAX_REQUEST = 512;       // Longest control request, secret included
+
+// New process: take over the listening socket of a server running on this machine.
+// Returns INVALID_SOCKET when no server answers on the control port.
+SOCKET receiveListeningSocket(int handoff_port, const std::string& secret);
+
+// Bind the loopback control port; retries while a previous process still holds it
+SOCKET openHandoffListener(int handoff_port);
+
+// Running process: answer one control connection by duplicating listening_socket into
+// the requesting process. Returns true once the new process has confirmed the takeover.
+bool serveHandoff(SOCKET control_listener, SOCKET listening_socket, const std::string& secret);
+
+#endif
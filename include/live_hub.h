@@ -0,0 +1,78 @@
+#ifndef LIVE_HUB_H
+#define LIVE_HUB_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <winsock2.h>
+
+// Publish/subscribe hub for live connections (WebSocket and Server-Sent Events).
+//
+// A published message is encoded once per protocol into a shared string; every
+// subscriber's queue gets a reference to it, never a copy. The hub only queues and
+// signals the subscriber's wake event; each connection's own thread does the sending,
+// so a slow client never stalls a publisher. A subscriber whose unsent backlog
+// passes the limit either loses messages or is disconnected, by policy.
+
+const int LIVE_HEARTBEAT_MS = 15000;     // Idle streams get an SSE comment / WebSocket ping this often
+const int LIVE_SEND_TIMEOUT_MS = 10000;  // A stream whose client stops reading is closed after this
+
+enum class LiveProtocol { WebSocket, EventStream };
+enum class SlowConsumerPolicy { Drop, Disconnect };
+
+// One streaming connection registered with the hub
+struct LiveSubscriber {
+	LiveProtocol protocol = LiveProtocol::EventStream;
+	WSAEVENT wake_event = WSA_INVALID_EVENT;   // Signaled when messages are queued or the subscriber must close
+
+	std::mutex mutex;
+	std::vector<std::shared_ptr<const std::string>> pending;   // Encoded messages not yet taken by the connection
+	size_t pending_bytes = 0;
+	size_t dropped = 0;       // Messages skipped under SlowConsumerPolicy::Drop
+	bool closing = false;     // Disconnected as a slow consumer, or the hub is shutting down
+};
+
+class LiveHub {
+public:
+	LiveHub(const std::string& path_prefix, size_t max_pending_bytes, SlowConsumerPolicy policy);
+
+	LiveHub(const LiveHub&) = delete;
+	LiveHub& operator=(const LiveHub&) = delete;
+
+	// Channel name for a request path under the prefix ("/live/news?x" -> "news"); false if not a live path
+	bool matchChannel(const std::string& path, std::string& channel) const;
+
+	void subscribe(const std::string& channel, LiveSubscriber* subscriber);
+	void unsubscribe(const std::string& channel, LiveSubscriber* subscriber);
+
+	// Encode once and queue to every subscriber of the channel; returns how many received it
+	size_t publish(const std::string& channel, std::string_view message, bool binary = false);
+
+	// Move the subscriber's queued messages into taken; false once the connection must close
+	static bool takePending(LiveSubscriber& subscriber, std::vector<std::shared_ptr<const std::string>>& taken);
+
+	// Shutdown/handoff: tell every subscriber to close
+	void closeAll();
+
+private:
+	struct Channel {
+		std::mutex mutex;
+		std::vector<LiveSubscriber*> subscribers;
+	};
+
+	std::string prefix;
+	size_t max_pending_bytes;
+	SlowConsumerPolicy policy;
+
+	std::mutex channels_mutex;
+	std::unordered_map<std::string, std::shared_ptr<Channel>> channels;   // Empty channels are removed
+	bool closed = false;
+};
+
+// SSE event for a message: one "data:" line per message line, then a blank line
+std::string encodeEventStream(std::string_view message);
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef MIME_TYPES_H
+#define MIME_TYPES_H
+
+#include <string>
+#include <string_view>
+
+// Default Content-Type for unknown or missing extensions
+constexpr std::string_view DEFAULT_MIME_TYPE = "application/octet-stream";
+
+// Look up the MIME type for a filename or path by its extension.
+// Case-insensitive, allocation-free and lock-free; the returned view points at static
+// (or frozen startup) storage and stays valid for the life of the process.
+std::string_view lookupMimeType(std::string_view filename);
+
+// Load extra "type ext1 ext2 ..." lines (mime.types format) that override the built-in table.
+// Only allowed before freezeMimeTypes(); returns false if the file cannot be read.
+bool loadMimeTypes(const std::string& file_path);
+
+// Make the extra mappings visible to lookups; no further loads are accepted afterwards
+void freezeMimeTypes();
+
+#endif
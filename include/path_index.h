@@ -0,0 +1,43 @@
+#ifndef PATH_INDEX_H
+#define PATH_INDEX_H
+
+#include <string>
+#include <unordered_map>
+#include <filesystem>
+#include <cstdint>
+
+// Metadata for one servable file, captured when the webroot is scanned
+struct FileEntry {
+	std::string file_path;                     // Filesystem path used to read the file
+	std::string mime_type;                     // Content-Type derived from the extension
+	std::uintmax_t size;                       // Size in bytes at scan time
+	std::filesystem::file_time_type mtime;     // Last write time at scan time
+};
+
+// Immutable snapshot of the webroot: normalized URL path ("/images/logo.png") -> file metadata.
+// Only regular files found under the webroot are indexed, so any URL that resolves
+// through the index is inside the webroot by construction.
+struct PathIndex {
+	std::unordered_map<std::string, FileEntry> entries;
+};
+
+// Uploads are written to "<target>.<n>.uploading" beside the target and renamed into place
+// when complete; files with this suffix are never indexed, so partial uploads are not served
+const char UPLOAD_TEMP_SUFFIX[] = ".uploading";
+
+// True for a path that names an in-progress upload
+bool isUploadTempFile(const std::string& path);
+
+// False if a segment of a normalized path is an NTFS alias for another name: ':' selects an
+// alternate data stream, and a trailing '.' or ' ' is stripped, so "/a.txt." writes "/a.txt"
+bool isPlainFilePath(const std::string& url_path);
+
+// Scan webroot recursively and build a new index snapshot (caller owns the result)
+PathIndex* buildPathIndex(const std::string& webroot);
+
+// Normalize a request target into an index key
+// Strips query/fragment, decodes %XX, collapses "//" and ".", maps "/dir/" to "/dir/index.html".
+// Returns "" if the path tries to climb above the root with "..".
+std::string normalizeUrlPath(const std::string& request_path);
+
+#endif
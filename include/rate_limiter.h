@@ -0,0 +1,69 @@
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+// Per-client rate limits: requests per second and response bytes per second.
+//
+// Clients are keyed by IPv4 address, or by subnet when prefix_bits < 32. Each client has one
+// token bucket per limit, kept in GCRA form: the bucket is a single "theoretical arrival
+// time", so charging it is one compare-and-swap and refilling is implicit in the clock.
+// Buckets live in a fixed open-addressing table split into shards; lookups and updates are
+// atomic operations only, no locks. Entries are never removed, so probe chains stay intact:
+// when a new client finds no free slot, it takes over the slot that has been idle longest.
+// Slots claimed less than a second ago are never taken over; a client that finds only such
+// slots is not tracked for that request.
+
+struct RateLimitOptions {
+	double requests_per_second = 0;   // 0 disables the request limit
+	double request_burst = 0;         // Requests allowed at once, 0 for one second's worth
+	double bytes_per_second = 0;      // 0 disables the bandwidth limit
+	double byte_burst = 0;            // Bytes allowed at once, 0 (or less than the rate) for one second's worth
+	int prefix_bits = 32;             // Clients sharing this many leading address bits share limits
+	size_t table_size = 65536;        // Client slots (rounded up to a power of two)
+};
+
+class RateLimiter {
+public:
+	explicit RateLimiter(const RateLimitOptions& options);
+
+	RateLimiter(const RateLimiter&) = delete;
+	RateLimiter& operator=(const RateLimiter&) = delete;
+
+	// Charge one request to the client (host byte order address); false if it is over either limit
+	bool admitRequest(uint32_t address);
+
+	// Charge response bytes; a client past its byte budget has its next requests refused
+	void chargeBytes(uint32_t address, size_t bytes);
+
+private:
+	static const size_t SLOTS_PER_SHARD = 8;   // A client hashes to one shard and is probed for only there
+
+	struct alignas(32) Slot {
+		std::atomic<uint64_t> key{0};            // Client key | KEY_PRESENT, 0 while the slot is free
+		std::atomic<uint64_t> request_tat{0};    // Theoretical arrival time of the next request (ns)
+		std::atomic<uint64_t> byte_tat{0};       // Same for the byte budget; 0 is a full bucket
+		std::atomic<uint64_t> claimed_ns{0};     // When the current client claimed the slot
+	};
+
+	// Slot key for a client address: its prefix | KEY_PRESENT
+	uint64_t clientKey(uint32_t address) const;
+
+	// Slot holding the client, claimed or taken over if it has none; nullptr when every slot
+	// in its shard was claimed too recently to take over
+	Slot* findSlot(uint64_t key, uint64_t now_ns);
+
+	uint32_t prefix_mask;
+	uint64_t request_interval_ns;   // Time one request's token takes to refill
+	uint64_t request_tolerance_ns;  // How far ahead of the clock the bucket may run (the burst)
+	double byte_interval_ns;        // Same per byte
+	uint64_t byte_tolerance_ns;
+
+	size_t shard_mask;              // Shard count - 1; shards are consecutive runs of SLOTS_PER_SHARD slots
+	std::unique_ptr<Slot[]> slots;
+};
+
+#endif
@@ -2,6 +2,7 @@
 #define REQUEST_PARSER_H
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <winsock2.h>
 #include "util.h"
@@ -17,6 +18,15 @@ struct RequestData {
 };
 
 RequestData parseRequest(const std::string& raw_request);
+// findRequestEnd() results for a complete head whose body cannot be framed; the connection must close
+const size_t REQUEST_BAD_LENGTH = std::string::npos - 1;             // Malformed or conflicting Content-Length
+const size_t REQUEST_UNSUPPORTED_ENCODING = std::string::npos - 2;   // Transfer-Encoding (only Content-Length bodies are read)
+
+size_t findRequestEnd(std::string_view buffer); /* length of the first complete request in buffer, npos if incomplete, or one of the errors above*/
+size_t findHeadEnd(std::string_view buffer); /* length of the request line and headers up to the blank line, npos if incomplete*/
+std::string getHeader(const RequestData& request, const std::string& name); /* name must be lowercase, "" if missing*/
+std::string_view findHeader(const RequestData& request, std::string_view name); /* like getHeader, but a view into the request (no copy)*/
+bool wantsKeepAlive(const RequestData& request);
 std::string readRequestFromSocket(SOCKET client_socket);
 
 #endif
\ No newline at end of file
@@ -2,18 +2,33 @@
 #define RESPONSE_BUILDER_H
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <memory>
 
 struct ResponseData {
 	int status_code;                                          // 200, 404, 500, etc.
 	std::string reason_phrase;                                // "OK", "Not Found", "Internal Server Error"
 	std::vector<std::pair<std::string, std::string>> headers; // Header name-value pairs
 	std::string body;                                         // Response body content
+
+	// Bytes that live outside the response (mapped asset bundle, shared file cache).
+	// body_owner keeps them alive until the response has been sent.
+	std::shared_ptr<const void> body_owner;
+	std::string_view external_body;                           // Sent instead of `body` when not empty
+	std::string_view precomputed_head;                        // Status line + headers already serialized (no blank line);
+	                                                          // `headers` are appended after it
 };
 
 // Function declarations
 ResponseData generateErrorResponse(int status_code, const std::string& message);
 std::string serializeResponse(const ResponseData& response);
+std::string serializeHeaders(const ResponseData& response);
+std::string serializeHeaderLines(const ResponseData& response);
+void appendHeaders(const ResponseData& response, std::string& out); /* like serializeHeaders, appending to a reused string*/
+void appendHeaderLines(const ResponseData& response, std::string& out);
+std::string_view responseBody(const ResponseData& response);
+void setHeader(ResponseData& response, const std::string& name, const std::string& value);
 std::string getMimeType(const std::string& filename);
 
 #endif
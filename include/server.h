@@ -4,20 +4,69 @@
 
 #include <iostream>
 #include <string>
+#include <deque>
+#include <memory>
+#include <vector>
 #include <winsock2.h>
+#include "buffer_pool.h"
 #pragma comment(lib, "ws2_32.lib")
 
+// TCP tuning for the listening socket and the connections accepted from it; 0 keeps the OS default
+struct ListenerOptions {
+	int backlog = SOMAXCONN;      // Accept queue length passed to listen()
+	bool no_delay = true;         // TCP_NODELAY on accepted sockets; responses already go out in one send
+	int fast_open_queue = 0;      // TCP_FASTOPEN: pending data-carrying SYNs (Windows treats it as on/off)
+	int defer_accept_s = 0;       // TCP_DEFER_ACCEPT: wake for a connection only once it sent data (Linux only)
+	int receive_buffer = 0;       // SO_RCVBUF, inherited by accepted sockets
+	int send_buffer = 0;          // SO_SNDBUF, inherited by accepted sockets
+};
+
 struct SocketServer {
 	SOCKET listening_socket;
 	int port;
+	ListenerOptions options;
+};
+
+// One piece of pending output. `owner` keeps the bytes alive until they are sent,
+// so header buffers and cached bodies can be queued without copying them.
+struct OutputSegment {
+	std::shared_ptr<const void> owner;
+	const char* data;
+	size_t length;
+};
+
+// Per-connection output queue. Responses are appended as segments and flushed
+// together with a single scatter-gather WSASend call.
+// Small pieces (headers, error bodies) are copied into pooled blocks owned by the queue;
+// the blocks go back to the pool once everything queued has been sent.
+struct OutputQueue {
+	std::deque<OutputSegment> segments;
+	size_t queued_bytes = 0;
+	std::vector<PooledBuffer> blocks;
+	size_t block_used = 0;   // Bytes used in blocks.back()
+
+	OutputQueue() = default;
+	OutputQueue(const OutputQueue&) = delete;
+	OutputQueue& operator=(const OutputQueue&) = delete;
+	~OutputQueue();
 };
 
-SocketServer createServerSocket( int Port); /*port is supposed to be obtained from the cmd line*/
+SocketServer createServerSocket( int Port, const ListenerOptions& options = ListenerOptions()); /*port is supposed to be obtained from the cmd line*/
 void bindSocket(const SocketServer& mySocket); /* bind created socket to desired port number*/
 void listenSocket(const SocketServer& mySocket); /*Listen on the created socket*/
-SOCKET acceptConnection(const SocketServer& mySocket); /* accepts incoming connections and provides new socket for communication*/
+int setNonBlocking(SOCKET socket_fd, bool non_blocking); /* switch FIONBIO, returns SOCKET_ERROR on failure*/
+SOCKET acceptConnection(const SocketServer& mySocket, sockaddr_in& peer); /* accepts incoming connections and provides new (blocking) socket for communication, peer gets the client's address; INVALID_SOCKET with WSAEWOULDBLOCK once the queue of a non-blocking listener is empty*/
+std::string formatAddress(const sockaddr_in& address); /* "a.b.c.d:port"*/
 int sendData(SOCKET client_socket, const std::string& data); /* send data to socket*/
 std::string receiveData(SOCKET client_socket); /* receiving data from client*/
+int receiveChunk(SOCKET client_socket, std::string& buffer); /* single recv() appended to buffer, returns bytes read*/
+int receiveChunk(SOCKET client_socket, IoBuffer& buffer); /* single recv() straight into the buffer's free space (call prepare() first)*/
+int waitForData(SOCKET client_socket); /* block until bytes arrive without reading them: >0 ready, 0 closed, -1 error/timeout*/
+void queueData(OutputQueue& queue, std::string data); /* queue an owned buffer (e.g. serialized headers)*/
+void queueSlice(OutputQueue& queue, std::shared_ptr<const void> owner, const char* data, size_t length); /* queue shared bytes without copying*/
+void queueCopy(OutputQueue& queue, const char* data, size_t length); /* copy small bytes into the queue's pooled blocks*/
+void releaseOutputBlocks(OutputQueue& queue); /* return pooled blocks once the queue has been sent*/
+int flushOutput(SOCKET client_socket, OutputQueue& queue); /* send queued segments, keeps unsent bytes queued on WSAEWOULDBLOCK*/
 void closeSocket(SOCKET socket_fd);
 
 #endif
\ No newline at end of file
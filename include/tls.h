@@ -0,0 +1,33 @@
+#ifndef TLS_H
+#define TLS_H
+
+#include <string>
+#include <winsock2.h>
+#include "server.h"
+
+// TLS termination for accepted client sockets, built on OpenSSL.
+// Compiled in only with the HTTP_ENABLE_TLS CMake option; without it createTlsContext
+// reports that TLS is unavailable and returns nullptr, so callers need no #ifdefs.
+
+const long TLS_SESSION_CACHE_SIZE = 20000;     // Server-side sessions kept for ID-based resumption
+const long TLS_SESSION_LIFETIME_S = 7200;      // Lifetime of cached sessions and session tickets
+const size_t TLS_RECORD_SIZE = 16384;          // Largest TLS record payload; small segments are coalesced up to this
+
+struct TlsContext;   // Certificate, key and session state shared by all connections
+struct TlsStream;    // One client connection after a completed handshake
+
+// Load certificate chain and private key (PEM). Session tickets and the server session
+// cache are enabled; kernel TLS offload is requested where the platform supports it.
+TlsContext* createTlsContext(const std::string& cert_file, const std::string& key_file);
+void destroyTlsContext(TlsContext* context);
+
+// Run the server handshake on an accepted socket; nullptr if it fails
+TlsStream* acceptTls(TlsContext* context, SOCKET client_socket);
+
+int tlsReceiveChunk(TlsStream* stream, IoBuffer& buffer); /* decrypt into the buffer's free space, 0 on close_notify*/
+bool tlsHasPending(TlsStream* stream); /* decrypted bytes are buffered inside the session (the socket may be idle)*/
+int tlsSendData(TlsStream* stream, const std::string& data); /* encrypt and send all of data*/
+int tlsFlushOutput(TlsStream* stream, OutputQueue& queue); /* send queued segments, coalescing small ones into full records*/
+void closeTls(TlsStream* stream); /* send close_notify and free the session; the socket is closed separately*/
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef TRACING_H
+#define TRACING_H
+
+#include <string>
+#include <cstdint>
+
+// Sampled per-request tracing.
+//
+// One request in `sample_rate` is traced: the connection thread records a span per phase
+// (receive, parse, resolve, read_file, serialize, send, ...) into its own buffer, without
+// locks. Buffers move to a global list when they fill up or their thread ends, and
+// writeChromeTrace() exports everything as Chrome trace JSON (chrome://tracing, Perfetto).
+// With tracing off a request costs one branch, and every span one more; with tracing on,
+// an unsampled request adds one step of a thread-local random generator.
+//
+// On Linux builds with <sys/sdt.h>, USDT probes fire for every request regardless of
+// sampling (a nop until a tracer attaches); elsewhere HTTP_TRACE_PROBE2 compiles away.
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define HTTP_TRACE_PROBE2(name, a, b) DTRACE_PROBE2(http_server, name, a, b)
+#endif
+#endif
+
+#ifndef HTTP_TRACE_PROBE2
+#define HTTP_TRACE_PROBE2(name, a, b) ((void)0)
+#endif
+
+const size_t TRACE_THREAD_BUFFER_EVENTS = 4096;   // Events a thread buffers before handing them to the global list
+
+// Trace one request in sample_rate (0 disables tracing); at most max_events are kept in total
+void configureTracing(unsigned int sample_rate, size_t max_events);
+
+extern unsigned int trace_sample_rate;          // 0 while tracing is off; set once at startup
+extern thread_local uint64_t trace_request_id;  // Non-zero while this thread works on a traced request
+
+// Random sampling decision for the request this thread is starting on
+void traceSampleRequest();
+
+// Called when a connection starts on its next request: decides whether that request is traced
+inline void traceRequestStart()
+{
+	trace_request_id = 0;
+	if (trace_sample_rate != 0)
+		traceSampleRequest();
+}
+
+// True while this thread works on a traced request; guards building trace labels
+inline bool traceActive()
+{
+	return trace_request_id != 0;
+}
+
+// Record the whole-request span, labelled e.g. "GET /index.html 200"; later spans on this
+// thread (such as the send of pipelined responses) still belong to the request
+void traceRequestEnd(const std::string& label);
+
+// Stop attributing spans to the current request (e.g. before a connection turns into a stream)
+inline void traceRequestStop()
+{
+	trace_request_id = 0;
+}
+
+uint64_t traceClockNs();   // Steady clock in nanoseconds
+void traceSpanEnd(const char* name, uint64_t start_ns);
+
+// Span start time, or 0 when the current request is not traced
+inline uint64_t traceSpanStart()
+{
+	return trace_request_id != 0 ? traceClockNs() : 0;
+}
+
+// Hand this thread's buffered events to the global list (also done when the thread exits)
+void flushThreadTrace();
+
+// Write every collected event as Chrome trace JSON; false if the file cannot be written
+bool writeChromeTrace(const std::string& file_path);
+
+// Times the enclosing scope as one phase of the traced request
+class TraceSpan {
+public:
+	explicit TraceSpan(const char* name) : name(name), start_ns(traceSpanStart()) {}
+	~TraceSpan()
+	{
+		if (start_ns != 0)
+			traceSpanEnd(name, start_ns);
+	}
+
+	TraceSpan(const TraceSpan&) = delete;
+	TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+	const char* name;   // String literal
+	uint64_t start_ns;
+};
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef UPSTREAM_PROXY_H
+#define UPSTREAM_PROXY_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <winsock2.h>
+#include "config.h"
+#include "request_parser.h"
+#include "response_builder.h"
+#include "tls.h"
+
+const int UPSTREAM_TIMEOUT_MS = 30000;         // Connect/read/write timeout towards a backend
+const int UPSTREAM_MAX_FAILURES = 3;           // Consecutive failures before a backend is marked down
+const int UPSTREAM_RETRY_AFTER_MS = 5000;      // How long a down backend is skipped
+const size_t UPSTREAM_MAX_IDLE = 32;           // Idle keep-alive connections kept per backend
+const size_t UPSTREAM_MAX_HEAD_SIZE = 65536;   // Largest response head buffered from a backend
+
+// One backend server with its pool of idle keep-alive connections
+struct Backend {
+	std::string host;
+	int port;
+	sockaddr_in address;
+
+	std::mutex pool_mutex;
+	std::vector<SOCKET> idle_connections;      // Connections ready for reuse
+
+	std::atomic<int> active_requests{0};       // In-flight requests, for least-connections
+	std::atomic<int> consecutive_failures{0};
+	std::atomic<long long> down_until_ms{0};   // Steady-clock ms; skipped by the balancer until then
+};
+
+enum class BalancePolicy { LeastConnections, RoundRobin };
+
+// A path prefix forwarded to a group of backends
+struct UpstreamRoute {
+	std::string prefix;
+	std::vector<std::unique_ptr<Backend>> backends;
+	std::atomic<unsigned int> next_backend{0};
+};
+
+// Reverse proxy for configured path prefixes. Requests are forwarded over pooled
+// persistent connections; response bodies are streamed to the client as they arrive.
+class UpstreamProxy {
+public:
+	UpstreamProxy(const std::vector<ProxyRouteConfig>& routes, BalancePolicy policy);
+	~UpstreamProxy();
+
+	UpstreamProxy(const UpstreamProxy&) = delete;
+	UpstreamProxy& operator=(const UpstreamProxy&) = delete;
+
+	// Longest configured prefix matching the path, nullptr if the request is not proxied
+	UpstreamRoute* matchRoute(const std::string& path);
+
+	// Forward a request and stream the response to the client (through client_tls when set).
+	// Returns false if nothing was sent; error_response then holds a 502/504 to queue instead.
+	// keep_alive is cleared when the client connection cannot be reused afterwards.
+	// sent_bytes receives what was written to the client, head included.
+	bool forwardRequest(UpstreamRoute& route, SOCKET client_socket, TlsStream* client_tls, const RequestData& request,
+		bool& keep_alive, ResponseData& error_response, uint64_t& sent_bytes);
+
+	bool empty() const { return routes.empty(); }
+
+private:
+	// Pick a healthy backend by policy; falls back to any backend when all are down
+	Backend* chooseBackend(UpstreamRoute& route);
+
+	// Reuse an idle pooled connection or open a new one; `reused` tells which
+	SOCKET acquireConnection(Backend& backend, bool& reused);
+	void releaseConnection(Backend& backend, SOCKET upstream_socket);
+
+	// Send the request and read the response head; `connected` tells whether the request left.
+	// A stale pooled connection is retried once, after a sent request only if it is idempotent.
+	SOCKET exchangeHead(Backend& backend, const std::string& upstream_request, bool idempotent,
+		std::string& buffer, size_t& head_end, bool& connected);
+
+	// A refused connection marks the backend down at once; other failures count towards it
+	void recordSuccess(Backend& backend);
+	void recordFailure(Backend& backend, bool refused);
+
+	std::vector<std::unique_ptr<UpstreamRoute>> routes;
+	BalancePolicy policy;
+};
+
+#endif
@@ -2,6 +2,7 @@
 #define UTIL_H
 
 #include <string>
+#include <string_view>
 #include <vector>
 
 std::string trim(const std::string& str);
@@ -10,5 +11,7 @@ std::string to_lowercase(const std::string& str);
 std::string to_uppercase(const std::string& str);
 bool contains(const std::string& str, const std::string& substring);
 size_t find_sequence(const std::string& str, const std::string& sequence);
+size_t utf8SequenceLength(std::string_view text, size_t pos); /* length of the valid UTF-8 sequence at pos, 0 if it is not one*/
+bool isValidUtf8(std::string_view text);
 
 #endif
\ No newline at end of file
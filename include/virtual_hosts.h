@@ -0,0 +1,53 @@
+#ifndef VIRTUAL_HOSTS_H
+#define VIRTUAL_HOSTS_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include "config.h"
+#include "file_handler.h"
+#include "response_builder.h"
+
+// Per-host counters, updated by client threads without locking
+struct HostMetrics {
+	std::atomic<unsigned long long> requests{0};
+	std::atomic<unsigned long long> client_errors{0};   // 4xx responses
+	std::atomic<unsigned long long> server_errors{0};   // 5xx responses
+	std::atomic<unsigned long long> body_bytes{0};      // Response body bytes queued
+};
+
+// One site: its own webroot index, file cache and metrics
+struct VirtualHost {
+	std::string name;                          // "example.com", "*.example.com" or "*"
+	std::unique_ptr<FileHandler> file_handler;
+	HostMetrics metrics;
+};
+
+// Host -> site table, built once at startup and read-only afterwards
+class VirtualHostTable {
+public:
+	// "*" is the catch-all host; default_host (if set) names the site used for unknown hosts instead
+	VirtualHostTable(const std::vector<VirtualHostConfig>& hosts, const std::string& default_host);
+
+	VirtualHostTable(const VirtualHostTable&) = delete;
+	VirtualHostTable& operator=(const VirtualHostTable&) = delete;
+
+	// Site for a Host header value: exact name, then the longest matching "*.suffix", then the default.
+	// The port and a trailing dot are ignored and names compare case-insensitively. Does not allocate.
+	VirtualHost* find(std::string_view host_header) const;
+
+	// Count a finished response against its host
+	static void recordResponse(VirtualHost& host, const ResponseData& response);
+
+	const std::vector<std::unique_ptr<VirtualHost>>& hosts() const { return all_hosts; }
+
+private:
+	std::vector<std::unique_ptr<VirtualHost>> all_hosts;
+	std::vector<std::pair<std::string, VirtualHost*>> exact_hosts;        // Sorted by lowercase name
+	std::vector<std::pair<std::string, VirtualHost*>> wildcard_suffixes;  // ".example.com", sorted
+	VirtualHost* default_host = nullptr;
+};
+
+#endif
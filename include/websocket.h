@@ -0,0 +1,61 @@
+#ifndef WEBSOCKET_H
+#define WEBSOCKET_H
+
+#include <string>
+#include <string_view>
+#include "request_parser.h"
+
+// WebSocket (RFC 6455) handshake and framing.
+// Server frames are never masked; client frames must be, and are unmasked while decoding.
+
+enum WebSocketOpcode : unsigned char {
+	WS_CONTINUATION = 0x0,
+	WS_TEXT = 0x1,
+	WS_BINARY = 0x2,
+	WS_CLOSE = 0x8,
+	WS_PING = 0x9,
+	WS_PONG = 0xA
+};
+
+// Close status codes sent by the server
+const unsigned short WS_CLOSE_NORMAL = 1000;
+const unsigned short WS_CLOSE_GOING_AWAY = 1001;
+const unsigned short WS_CLOSE_PROTOCOL_ERROR = 1002;
+const unsigned short WS_CLOSE_INVALID_DATA = 1007;
+const unsigned short WS_CLOSE_TOO_BIG = 1009;
+
+struct WebSocketFrame {
+	bool fin = false;
+	unsigned char opcode = WS_CONTINUATION;
+	std::string payload;
+};
+
+// GET with "Upgrade: websocket" and "Connection: ... upgrade ..."
+bool isWebSocketUpgrade(const RequestData& request);
+
+// Sec-WebSocket-Accept value for the client's Sec-WebSocket-Key: base64(SHA-1(key + GUID))
+std::string webSocketAccept(std::string_view key);
+
+// One complete, unfragmented server frame
+std::string encodeWebSocketFrame(unsigned char opcode, std::string_view payload);
+
+// Close frame carrying a status code
+std::string encodeWebSocketClose(unsigned short status_code);
+
+// Longest frame header: 2 bytes, a 64-bit length and the mask
+const size_t WS_MAX_HEADER_LENGTH = 14;
+
+// decodeWebSocketFrame results besides the frame length
+const size_t WS_FRAME_INCOMPLETE = 0;
+const size_t WS_FRAME_ERROR = std::string::npos;        // Unmasked frame, reserved bits or opcode, bad control frame
+const size_t WS_FRAME_TOO_BIG = std::string::npos - 1;  // Payload longer than max_payload
+
+// Decode the first frame of buffer, unmasking its payload into frame.
+// Returns the bytes the frame occupies or one of the WS_FRAME_ results.
+size_t decodeWebSocketFrame(std::string_view buffer, size_t max_payload, WebSocketFrame& frame);
+
+// Close code for a complete text message or close frame whose payload is not allowed, 0 if it is:
+// text must be valid UTF-8, and a close body is empty or a status code and a UTF-8 reason
+unsigned short webSocketPayloadError(unsigned char opcode, std::string_view payload);
+
+#endif
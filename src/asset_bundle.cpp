@@ -0,0 +1,122 @@
+#include "asset_bundle.h"
+#include <iostream>
+#include <cstring>
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+std::string gzipEtag(std::string_view etag)
+{
+	if (etag.empty())
+		return std::string();
+	return std::string(etag.substr(0, etag.size() - 1)) + "-gz\"";
+}
+
+// Map and validate the bundle
+std::unique_ptr<AssetBundle> AssetBundle::open(const std::string& bundle_path)
+{
+	HANDLE file = CreateFileA(bundle_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		std::cout << "[BUNDLE] Cannot open bundle: " << bundle_path << std::endl;
+		return nullptr;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || static_cast<uint64_t>(size.QuadPart) < sizeof(BundleHeader))
+	{
+		std::cout << "[BUNDLE] Bundle too small: " << bundle_path << std::endl;
+		CloseHandle(file);
+		return nullptr;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);  // The mapping keeps the file open
+	if (mapping == nullptr)
+	{
+		std::cout << "[BUNDLE] Cannot map bundle: " << GetLastError() << std::endl;
+		return nullptr;
+	}
+
+	const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);  // The view keeps the mapping alive
+	if (view == nullptr)
+	{
+		std::cout << "[BUNDLE] Cannot map bundle view: " << GetLastError() << std::endl;
+		return nullptr;
+	}
+
+	std::unique_ptr<AssetBundle> bundle(new AssetBundle());
+	bundle->mapped = std::shared_ptr<const void>(view, [](const void* address) { UnmapViewOfFile(address); });
+	bundle->base = static_cast<const char*>(view);
+	bundle->file_size = static_cast<uint64_t>(size.QuadPart);
+
+	// Only the fixed-size header is checked here so startup stays O(1);
+	// entry offsets are bounds-checked when an entry is used
+	BundleHeader header;
+	std::memcpy(&header, bundle->base, sizeof(header));
+	if (std::memcmp(header.magic, BUNDLE_MAGIC, sizeof(BUNDLE_MAGIC)) != 0 || header.version != BUNDLE_VERSION ||
+		header.file_size != bundle->file_size || header.entries_offset % alignof(BundleEntry) != 0 ||
+		header.entries_offset > bundle->file_size ||
+		header.entry_count > (bundle->file_size - header.entries_offset) / sizeof(BundleEntry))
+	{
+		std::cout << "[BUNDLE] Invalid bundle header: " << bundle_path << std::endl;
+		return nullptr;
+	}
+
+	bundle->entries = reinterpret_cast<const BundleEntry*>(bundle->base + header.entries_offset);
+	bundle->entry_count = header.entry_count;
+
+	std::cout << "[BUNDLE] Mapped " << bundle->entry_count << " assets from " << bundle_path
+		<< " (" << bundle->file_size << " bytes)" << std::endl;
+	return bundle;
+}
+
+// Bounds-checked view into the mapping; data() is nullptr when out of range
+std::string_view AssetBundle::view(uint64_t offset, uint64_t length) const
+{
+	if (offset > file_size || length > file_size - offset)
+		return std::string_view(nullptr, 0);
+
+	return std::string_view(base + offset, static_cast<size_t>(length));
+}
+
+// Binary search the sorted path table (sorted by the packer)
+bool AssetBundle::find(std::string_view url_path, BundleAsset& asset) const
+{
+	size_t low = 0;
+	size_t high = entry_count;
+
+	while (low < high)
+	{
+		size_t middle = low + (high - low) / 2;
+		const BundleEntry& entry = entries[middle];
+		std::string_view path = view(entry.path_offset, entry.path_length);
+
+		if (path.data() == nullptr)
+		{
+			return false;  // Corrupt entry
+		}
+		else if (path < url_path)
+		{
+			low = middle + 1;
+		}
+		else if (url_path < path)
+		{
+			high = middle;
+		}
+		else
+		{
+			asset.etag = view(entry.etag_offset, entry.etag_length);
+			asset.head = view(entry.head_offset, entry.head_length);
+			asset.body = view(entry.body_offset, entry.body_length);
+			asset.gzip_head = view(entry.gzip_head_offset, entry.gzip_head_length);
+			asset.gzip_body = view(entry.gzip_body_offset, entry.gzip_body_length);
+
+			return asset.etag.data() != nullptr && asset.head.data() != nullptr && asset.body.data() != nullptr &&
+				asset.gzip_head.data() != nullptr && asset.gzip_body.data() != nullptr;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,176 @@
+#include "buffer_pool.h"
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <cstring>
+
+namespace {
+
+struct FreeLists {
+	std::vector<char*> lists[BUFFER_CLASS_COUNT];
+};
+
+std::mutex global_mutex;
+FreeLists global_free;
+
+std::atomic<size_t> thread_cache_limit(16);
+std::atomic<size_t> global_limit(1024);
+
+// Index of the smallest class that fits size, BUFFER_CLASS_COUNT if none does
+size_t classIndex(size_t size)
+{
+	for (size_t i = 0; i < BUFFER_CLASS_COUNT; i++)
+	{
+		if (size <= BUFFER_SIZE_CLASSES[i])
+			return i;
+	}
+	return BUFFER_CLASS_COUNT;
+}
+
+// Hand a thread's free buffers to the global lists; what does not fit is freed
+void spillToGlobal(FreeLists& local)
+{
+	bool empty = true;
+	for (size_t i = 0; i < BUFFER_CLASS_COUNT; i++)
+		empty = empty && local.lists[i].empty();
+	if (empty)
+		return;
+
+	std::lock_guard<std::mutex> lock(global_mutex);
+	for (size_t i = 0; i < BUFFER_CLASS_COUNT; i++)
+	{
+		for (char* data : local.lists[i])
+		{
+			if (global_free.lists[i].size() < global_limit)
+				global_free.lists[i].push_back(data);
+			else
+				delete[] data;
+		}
+		local.lists[i].clear();
+	}
+}
+
+// Per-thread free lists; a finishing client thread returns its buffers to the global lists
+struct ThreadCache {
+	FreeLists free;
+	~ThreadCache() { spillToGlobal(free); }
+};
+
+thread_local ThreadCache thread_cache;
+
+}
+
+void configureBufferPool(size_t thread_limit, size_t global_buffer_limit)
+{
+	thread_cache_limit = thread_limit;
+	global_limit = global_buffer_limit;
+}
+
+PooledBuffer acquireBuffer(size_t min_capacity)
+{
+	size_t index = classIndex(min_capacity);
+	if (index == BUFFER_CLASS_COUNT)
+		return {new char[min_capacity], min_capacity};
+
+	PooledBuffer buffer;
+	buffer.capacity = BUFFER_SIZE_CLASSES[index];
+
+	std::vector<char*>& local = thread_cache.free.lists[index];
+	if (!local.empty())
+	{
+		buffer.data = local.back();
+		local.pop_back();
+		return buffer;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(global_mutex);
+		std::vector<char*>& global = global_free.lists[index];
+		if (!global.empty())
+		{
+			buffer.data = global.back();
+			global.pop_back();
+			return buffer;
+		}
+	}
+
+	buffer.data = new char[buffer.capacity];
+	return buffer;
+}
+
+void releaseBuffer(PooledBuffer& buffer)
+{
+	if (buffer.data == nullptr)
+		return;
+
+	// One-off allocations larger than every class go straight back to the heap
+	size_t index = classIndex(buffer.capacity);
+	if (index == BUFFER_CLASS_COUNT || BUFFER_SIZE_CLASSES[index] != buffer.capacity)
+	{
+		delete[] buffer.data;
+	}
+	else if (thread_cache.free.lists[index].size() < thread_cache_limit)
+	{
+		thread_cache.free.lists[index].push_back(buffer.data);
+	}
+	else
+	{
+		std::lock_guard<std::mutex> lock(global_mutex);
+		if (global_free.lists[index].size() < global_limit)
+			global_free.lists[index].push_back(buffer.data);
+		else
+			delete[] buffer.data;
+	}
+
+	buffer.data = nullptr;
+	buffer.capacity = 0;
+}
+
+void releaseThreadBuffers()
+{
+	spillToGlobal(thread_cache.free);
+}
+
+bool IoBuffer::prepare(size_t min_free, size_t max_capacity)
+{
+	if (writable() >= min_free)
+		return true;
+
+	size_t needed = length() + min_free;
+	if (needed > max_capacity)
+		return false;
+
+	// Enough room once the consumed front is reclaimed: slide the bytes down
+	if (buffer.data != nullptr && buffer.capacity >= needed)
+	{
+		std::memmove(buffer.data, buffer.data + start, length());
+		end -= start;
+		start = 0;
+		return true;
+	}
+
+	// Grow to the next size class; past the largest class, go straight to the limit
+	size_t largest_class = BUFFER_SIZE_CLASSES[BUFFER_CLASS_COUNT - 1];
+	PooledBuffer grown = acquireBuffer(needed > largest_class ? max_capacity : needed);
+	if (!empty())
+		std::memcpy(grown.data, buffer.data + start, length());
+
+	end = length();
+	start = 0;
+	releaseBuffer(buffer);
+	buffer = grown;
+	return true;
+}
+
+void IoBuffer::consume(size_t count)
+{
+	start += count;
+	if (start >= end)
+		start = end = 0;
+}
+
+void IoBuffer::release()
+{
+	releaseBuffer(buffer);
+	start = end = 0;
+}
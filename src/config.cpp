@@ -0,0 +1,194 @@
+#include "config.h"
+#include "util.h"
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <algorithm>
+
+// Parse "key value" lines; '#' starts a comment
+ServerConfig loadConfig(const std::string& config_path)
+{
+	ServerConfig config;
+
+	std::ifstream file(config_path);
+	if (!file.is_open())
+	{
+		std::cout << "[CONFIG] Cannot open config file: " << config_path << std::endl;
+		return config;
+	}
+
+	std::string line;
+	int line_number = 0;
+	while (std::getline(file, line))
+	{
+		line_number++;
+		line = trim(line.substr(0, line.find('#')));
+		if (line.empty())
+			continue;
+
+		// Split into key and the rest of the line as value
+		size_t space_pos = line.find_first_of(" \t");
+		std::string key = to_lowercase(line.substr(0, space_pos));
+		std::string value = space_pos == std::string::npos ? "" : trim(line.substr(space_pos));
+
+		if (key == "mime_types")
+		{
+			config.mime_types_file = value;
+		}
+		else if (key == "bundle")
+		{
+			config.bundle_file = value;
+		}
+		else if (key == "proxy")
+		{
+			std::vector<std::string> tokens = split(value, ' ');
+			if (tokens.size() < 2 || tokens[0].empty() || tokens[0][0] != '/')
+			{
+				std::cout << "[CONFIG] proxy needs a /prefix and at least one host:port on line " << line_number << std::endl;
+				continue;
+			}
+			config.proxy_routes.push_back({tokens[0], std::vector<std::string>(tokens.begin() + 1, tokens.end())});
+		}
+		else if (key == "proxy_balance")
+		{
+			config.proxy_balance = value;
+		}
+		else if (key == "tls_cert")
+		{
+			config.tls_cert_file = value;
+		}
+		else if (key == "tls_key")
+		{
+			config.tls_key_file = value;
+		}
+		else if (key == "vhost")
+		{
+			std::vector<std::string> tokens = split(value, ' ');
+			if (tokens.size() < 2 || tokens.size() > 3)
+			{
+				std::cout << "[CONFIG] vhost needs a host, a webroot and optionally a bundle on line " << line_number << std::endl;
+				continue;
+			}
+			config.virtual_hosts.push_back({tokens[0], tokens[1], tokens.size() == 3 ? tokens[2] : ""});
+		}
+		else if (key == "default_host")
+		{
+			config.default_host = value;
+		}
+		else if (key == "live")
+		{
+			config.live_prefix = value;
+		}
+		else if (key == "live_queue_limit")
+		{
+			config.live_queue_limit = std::strtoul(value.c_str(), nullptr, 10);
+		}
+		else if (key == "live_slow_consumer")
+		{
+			config.live_slow_consumer = to_lowercase(value);
+		}
+		else if (key == "uploads")
+		{
+			config.uploads = to_lowercase(value) == "on";
+		}
+		else if (key == "upload_max_size")
+		{
+			config.upload_max_size = std::strtoull(value.c_str(), nullptr, 10);
+		}
+		else if (key == "max_request_size")
+		{
+			config.max_request_size = std::strtoul(value.c_str(), nullptr, 10);
+		}
+		else if (key == "buffer_thread_cache")
+		{
+			config.buffer_thread_cache = std::strtoul(value.c_str(), nullptr, 10);
+		}
+		else if (key == "buffer_global_cache")
+		{
+			config.buffer_global_cache = std::strtoul(value.c_str(), nullptr, 10);
+		}
+		else if (key == "listen_backlog")
+		{
+			config.listen_backlog = std::atoi(value.c_str());
+		}
+		else if (key == "tcp_nodelay")
+		{
+			config.tcp_nodelay = to_lowercase(value) != "off";
+		}
+		else if (key == "tcp_fastopen")
+		{
+			config.tcp_fastopen = std::atoi(value.c_str());
+		}
+		else if (key == "defer_accept")
+		{
+			config.defer_accept = std::atoi(value.c_str());
+		}
+		else if (key == "socket_rcvbuf")
+		{
+			config.socket_rcvbuf = std::atoi(value.c_str());
+		}
+		else if (key == "socket_sndbuf")
+		{
+			config.socket_sndbuf = std::atoi(value.c_str());
+		}
+		else if (key == "accept_batch")
+		{
+			config.accept_batch = std::max(1, std::atoi(value.c_str()));
+		}
+		else if (key == "rate_limit_requests")
+		{
+			config.rate_limit_requests = std::strtod(value.c_str(), nullptr);
+		}
+		else if (key == "rate_limit_burst")
+		{
+			config.rate_limit_burst = std::strtod(value.c_str(), nullptr);
+		}
+		else if (key == "rate_limit_bytes")
+		{
+			config.rate_limit_bytes = std::strtod(value.c_str(), nullptr);
+		}
+		else if (key == "rate_limit_byte_burst")
+		{
+			config.rate_limit_byte_burst = std::strtod(value.c_str(), nullptr);
+		}
+		else if (key == "rate_limit_prefix")
+		{
+			config.rate_limit_prefix = std::atoi(value.c_str());
+		}
+		else if (key == "rate_limit_clients")
+		{
+			config.rate_limit_clients = std::strtoul(value.c_str(), nullptr, 10);
+		}
+		else if (key == "trace_sample_rate")
+		{
+			config.trace_sample_rate = std::strtoul(value.c_str(), nullptr, 10);
+		}
+		else if (key == "trace_file")
+		{
+			config.trace_file = value;
+		}
+		else if (key == "trace_max_events")
+		{
+			config.trace_max_events = std::strtoul(value.c_str(), nullptr, 10);
+		}
+		else if (key == "handoff_port")
+		{
+			config.handoff_port = std::atoi(value.c_str());
+		}
+		else if (key == "handoff_secret")
+		{
+			config.handoff_secret = value;
+		}
+		else if (key == "drain_timeout")
+		{
+			config.drain_timeout = std::atoi(value.c_str());
+		}
+		else
+		{
+			std::cout << "[CONFIG] Unknown setting '" << key << "' on line " << line_number << std::endl;
+		}
+	}
+
+	std::cout << "[CONFIG] Loaded " << config_path << std::endl;
+	return config;
+}
@@ -0,0 +1,751 @@
+#include "connection_handler.h"
+#include "websocket.h"
+#include "tracing.h"
+#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <chrono>
+
+// Ready-made answer for a client over its rate limit, queued without copying or formatting
+static const char TOO_MANY_REQUESTS[] =
+	"HTTP/1.1 429 Too Many Requests\r\n"
+	"Content-Type: text/plain\r\n"
+	"Content-Length: 23\r\n"
+	"Retry-After: 1\r\n"
+	"Connection: close\r\n"
+	"\r\n"
+	"429 Too Many Requests\r\n";
+
+// Produce the response for one parsed request
+ResponseData dispatchRequest(const RequestData& request, FileHandler& file_handler)
+{
+	// Validate request
+	if (!request.is_valid)
+	{
+		std::cout << "[HANDLER] Invalid request: " << request.error_message << std::endl;
+		return generateErrorResponse(400, "Bad Request: " + request.error_message);
+	}
+
+	// Handle the request (currently only GET)
+	if (request.method == "GET")
+	{
+		std::cout << "[HANDLER] Handling GET request for: " << request.path << std::endl;
+		return file_handler.handleGetRequest(request);
+	}
+
+	std::cout << "[HANDLER] Unsupported method: " << request.method << std::endl;
+	return generateErrorResponse(405, "Method Not Allowed");
+}
+
+// Append a response to the connection's output queue
+// The header block and the body become separate segments, so large bodies are never copied.
+// Precomputed heads and external bodies are queued as slices of their owner's memory;
+// headers and small bodies are copied into the queue's pooled blocks.
+void queueResponse(Connection& connection, ResponseData& response)
+{
+	TraceSpan span("serialize");
+
+	// Reused per thread, so building the header block does not allocate once warmed up
+	thread_local std::string head;
+	head.clear();
+
+	if (!response.precomputed_head.empty())
+	{
+		queueSlice(connection.output, response.body_owner, response.precomputed_head.data(), response.precomputed_head.length());
+		appendHeaderLines(response, head);
+	}
+	else
+	{
+		appendHeaders(response, head);
+	}
+	queueCopy(connection.output, head.data(), head.length());
+
+	if (!response.external_body.empty())
+		queueSlice(connection.output, response.body_owner, response.external_body.data(), response.external_body.length());
+	else if (response.body.length() <= BUFFER_SIZE_CLASSES[0])
+		queueCopy(connection.output, response.body.data(), response.body.length());
+	else
+		queueData(connection.output, std::move(response.body));
+}
+
+// Read more input, through the TLS session if there is one
+// The input buffer grows through the pool's size classes, up to max_request_size
+static int receiveInput(Connection& connection, size_t max_request_size, size_t min_free = 1)
+{
+	TraceSpan span("receive");
+
+	if (!connection.input.prepare(min_free, max_request_size))
+		return -1;
+
+	if (connection.tls != nullptr)
+		return tlsReceiveChunk(connection.tls, connection.input);
+	return receiveChunk(connection.socket, connection.input);
+}
+
+// Wait for the next request without holding any buffers
+static int waitForInput(Connection& connection)
+{
+	// Decrypted bytes may already sit inside the TLS session with nothing left on the socket
+	if (connection.tls != nullptr && tlsHasPending(connection.tls))
+		return 1;
+
+	connection.input.release();
+	releaseThreadBuffers();
+	return waitForData(connection.socket);
+}
+
+// Count bytes sent to the client against its bandwidth limit
+static void chargeClient(ServerContext& context, const Connection& connection, uint64_t bytes)
+{
+	if (context.limiter != nullptr)
+		context.limiter->chargeBytes(ntohl(connection.peer.sin_addr.s_addr), bytes);
+}
+
+// Queue a response and charge the client for every byte queued, head included
+static void queueChargedResponse(Connection& connection, ServerContext& context, ResponseData& response)
+{
+	size_t queued_before = connection.output.queued_bytes;
+	queueResponse(connection, response);
+	chargeClient(context, connection, connection.output.queued_bytes - queued_before);
+}
+
+// Send everything queued, through the TLS session if there is one
+static int flushConnection(Connection& connection)
+{
+	if (connection.output.segments.empty())
+		return 0;
+
+	TraceSpan span("send");
+
+	if (connection.tls != nullptr)
+		return tlsFlushOutput(connection.tls, connection.output);
+	return flushOutput(connection.socket, connection.output);
+}
+
+// PUT/POST the server stores as an upload: uploads are on and no proxy route or live channel
+// claims the path. Such a request is handled once its head is buffered, without its body.
+static bool isUploadRequestLine(std::string_view buffer, const ServerContext& context)
+{
+	if (!context.uploads || (buffer.substr(0, 4) != "PUT " && buffer.substr(0, 5) != "POST "))
+		return false;
+
+	size_t line_end = buffer.find("\r\n");
+	if (line_end == std::string_view::npos)
+		return false;
+
+	std::vector<std::string> tokens = split(std::string(buffer.substr(0, line_end)), ' ');
+	if (tokens.size() != 3)
+		return false;
+
+	std::string channel;
+	return !(context.proxy != nullptr && context.proxy->matchRoute(tokens[1]) != nullptr) &&
+		!(context.live != nullptr && context.live->matchChannel(tokens[1], channel));
+}
+
+// Stream an upload's body into the site's webroot. Memory use is one pooled chunk however
+// large the body is: bytes already buffered behind the head are written first, then the
+// rest is received and written a chunk at a time.
+static ResponseData receiveUpload(Connection& connection, const ServerContext& context, FileHandler& file_handler, const RequestData& request)
+{
+	if (!request.is_valid)
+		return generateErrorResponse(400, "Bad Request: " + request.error_message);
+
+	// The size must be known up front for the limit and the preallocation
+	// (chunked bodies were already refused while framing the request)
+	std::string length_header(findHeader(request, "content-length"));
+	if (length_header.empty())
+		return generateErrorResponse(411, "Length Required");
+
+	char* length_end = nullptr;
+	uint64_t content_length = std::strtoull(length_header.c_str(), &length_end, 10);
+	if (length_header.find_first_not_of("0123456789") != std::string::npos || *length_end != '\0')
+		return generateErrorResponse(400, "Bad Request: invalid Content-Length");
+
+	if (context.upload_max_size != 0 && content_length > context.upload_max_size)
+	{
+		std::cout << "[HANDLER] Upload of " << content_length << " bytes is over the limit" << std::endl;
+		return generateErrorResponse(413, "Payload Too Large");
+	}
+
+	PendingUpload upload;
+	ResponseData response = file_handler.beginUpload(request.path, content_length, upload);
+	if (response.status_code != 0)
+		return response;
+
+	// A client that asked first sends the body only after this
+	if (to_lowercase(std::string(findHeader(request, "expect"))) == "100-continue")
+	{
+		static const char CONTINUE[] = "HTTP/1.1 100 Continue\r\n\r\n";
+		queueCopy(connection.output, CONTINUE, sizeof(CONTINUE) - 1);
+		if (flushConnection(connection) < 0)
+		{
+			file_handler.abortUpload(upload);
+			return generateErrorResponse(400, "Bad Request");
+		}
+	}
+
+	uint64_t remaining = content_length;
+	bool write_failed = false;
+	while (remaining > 0)
+	{
+		if (connection.input.empty() && receiveInput(connection, UPLOAD_CHUNK_SIZE, UPLOAD_CHUNK_SIZE) <= 0)
+			break;
+
+		// Anything past the body is the next pipelined request and stays buffered
+		size_t length = static_cast<size_t>(std::min<uint64_t>(remaining, connection.input.length()));
+		if (!file_handler.writeUpload(upload, connection.input.view().data(), length))
+		{
+			write_failed = true;
+			break;
+		}
+		connection.input.consume(length);
+		remaining -= length;
+	}
+
+	if (remaining > 0)
+	{
+		file_handler.abortUpload(upload);
+		if (write_failed)
+			return generateErrorResponse(500, "Internal Server Error");
+		return generateErrorResponse(400, "Bad Request: incomplete body");
+	}
+
+	return file_handler.finishUpload(upload);
+}
+
+ResponseData respondFromSite(const RequestData& request, ServerContext& context, bool& keep_alive, Connection* upload_connection)
+{
+	// Uploads and deletes change the site's webroot when they are enabled
+	VirtualHost* host = context.hosts->find(findHeader(request, "host"));
+	ResponseData response;
+	if (upload_connection != nullptr)
+	{
+		TraceSpan span("upload");
+		response = receiveUpload(*upload_connection, context, *host->file_handler, request);
+
+		// A refused upload leaves its body unread on the socket, where it would be parsed as the next request
+		if (response.status_code >= 400)
+			keep_alive = false;
+	}
+	else if (context.uploads && request.is_valid && request.method == "DELETE")
+	{
+		TraceSpan span("delete");
+		response = host->file_handler->deleteFile(request.path);
+	}
+	else
+	{
+		TraceSpan span("dispatch");
+		response = dispatchRequest(request, *host->file_handler);
+	}
+	VirtualHostTable::recordResponse(*host, response);
+
+	for (const auto& header : response.headers)
+	{
+		if (header.first == "Connection" && header.second == "close")
+			keep_alive = false;
+	}
+	setHeader(response, "Connection", keep_alive ? "keep-alive" : "close");
+	return response;
+}
+
+// Answer a POST to a live channel: the body is broadcast to the channel's subscribers
+static ResponseData publishToChannel(LiveHub& live, const std::string& channel, const RequestData& request)
+{
+	size_t delivered = live.publish(channel, request.body);
+	std::cout << "[LIVE] Published " << request.body.length() << " bytes to " << channel << " (" << delivered << " subscribers)" << std::endl;
+
+	ResponseData response;
+	response.status_code = 200;
+	response.reason_phrase = "OK";
+	response.body = std::to_string(delivered) + "\r\n";
+	response.headers.push_back({"Content-Type", "text/plain"});
+	response.headers.push_back({"Content-Length", std::to_string(response.body.length())});
+	return response;
+}
+
+// Handle the WebSocket frames buffered in the connection's input. Complete text and binary
+// messages are published to the channel; `message` carries a fragmented one across calls.
+// Returns false once the connection should close (a close frame is queued then).
+static bool processWebSocketInput(Connection& connection, ServerContext& context, const std::string& channel, WebSocketFrame& message)
+{
+	// The input buffer holds at most max_request_size, header included, so a payload at the
+	// limit still arrives whole and a larger one is refused with 1009 from its header
+	size_t max_payload = context.max_request_size > WS_MAX_HEADER_LENGTH ? context.max_request_size - WS_MAX_HEADER_LENGTH : 0;
+
+	WebSocketFrame frame;
+	while (true)
+	{
+		size_t frame_length = decodeWebSocketFrame(connection.input.view(), max_payload, frame);
+		if (frame_length == WS_FRAME_INCOMPLETE)
+			return true;
+
+		if (frame_length == WS_FRAME_ERROR || frame_length == WS_FRAME_TOO_BIG)
+		{
+			queueData(connection.output, encodeWebSocketClose(frame_length == WS_FRAME_TOO_BIG ? WS_CLOSE_TOO_BIG : WS_CLOSE_PROTOCOL_ERROR));
+			return false;
+		}
+		connection.input.consume(frame_length);
+
+		if (frame.opcode == WS_PING)
+		{
+			queueData(connection.output, encodeWebSocketFrame(WS_PONG, frame.payload));
+			continue;
+		}
+		if (frame.opcode == WS_PONG)
+			continue;
+		if (frame.opcode == WS_CLOSE)
+		{
+			// Echo the client's status code, then close
+			if (unsigned short error = webSocketPayloadError(WS_CLOSE, frame.payload))
+				queueData(connection.output, encodeWebSocketClose(error));
+			else
+				queueData(connection.output, encodeWebSocketFrame(WS_CLOSE, std::string_view(frame.payload).substr(0, 2)));
+			return false;
+		}
+
+		// A data frame starts a message unless one is in progress, which only continuations may extend
+		bool in_progress = message.opcode != WS_CONTINUATION;
+		if (in_progress != (frame.opcode == WS_CONTINUATION))
+		{
+			queueData(connection.output, encodeWebSocketClose(WS_CLOSE_PROTOCOL_ERROR));
+			return false;
+		}
+
+		if (!in_progress)
+			message.opcode = frame.opcode;
+		message.payload += frame.payload;
+
+		if (message.payload.length() > max_payload)
+		{
+			queueData(connection.output, encodeWebSocketClose(WS_CLOSE_TOO_BIG));
+			return false;
+		}
+
+		if (frame.fin)
+		{
+			// Text is checked once whole, since a fragment may end inside a character
+			if (unsigned short error = webSocketPayloadError(message.opcode, message.payload))
+			{
+				queueData(connection.output, encodeWebSocketClose(error));
+				return false;
+			}
+
+			context.live->publish(channel, message.payload, message.opcode == WS_BINARY);
+			message.opcode = WS_CONTINUATION;
+			message.payload.clear();
+		}
+	}
+}
+
+// Switch the connection to a live stream (WebSocket or Server-Sent Events) on the channel and
+// relay its messages until either side closes. The thread sleeps on two events at once: the
+// hub's wake event and the socket's read/close event.
+static void serveLiveStream(Connection& connection, ServerContext& context, const RequestData& request, const std::string& channel)
+{
+	LiveSubscriber subscriber;
+	bool websocket = isWebSocketUpgrade(request);
+	ResponseData response;
+
+	if (websocket)
+	{
+		std::string_view key = findHeader(request, "sec-websocket-key");
+		if (key.empty() || findHeader(request, "sec-websocket-version") != "13")
+		{
+			response = generateErrorResponse(400, "Bad Request");
+			setHeader(response, "Sec-WebSocket-Version", "13");
+			queueResponse(connection, response);
+			return;
+		}
+
+		subscriber.protocol = LiveProtocol::WebSocket;
+		response.status_code = 101;
+		response.reason_phrase = "Switching Protocols";
+		response.headers.push_back({"Upgrade", "websocket"});
+		response.headers.push_back({"Connection", "Upgrade"});
+		response.headers.push_back({"Sec-WebSocket-Accept", webSocketAccept(key)});
+	}
+	else
+	{
+		// No Content-Length: the event stream lasts until the connection closes
+		subscriber.protocol = LiveProtocol::EventStream;
+		response.status_code = 200;
+		response.reason_phrase = "OK";
+		response.headers.push_back({"Content-Type", "text/event-stream"});
+		response.headers.push_back({"Cache-Control", "no-cache"});
+		response.headers.push_back({"Connection", "close"});
+	}
+
+	queueResponse(connection, response);
+	chargeClient(context, connection, connection.output.queued_bytes);
+	if (flushConnection(connection) < 0)
+		return;
+
+	// A consumer that stops reading blocks only its own thread, and only this long
+	DWORD send_timeout_ms = LIVE_SEND_TIMEOUT_MS;
+	setsockopt(connection.socket, SOL_SOCKET, SO_SNDTIMEO, (const char*)&send_timeout_ms, sizeof(send_timeout_ms));
+
+	WSAEVENT socket_event = WSACreateEvent();
+	subscriber.wake_event = WSACreateEvent();
+	WSAEVENT events[2] = {subscriber.wake_event, socket_event};
+
+	context.live->subscribe(channel, &subscriber);
+	std::cout << "[LIVE] " << (websocket ? "WebSocket" : "Event stream") << " subscribed to " << channel << std::endl;
+
+	std::vector<std::shared_ptr<const std::string>> messages;
+	WebSocketFrame message;
+	bool open = true;
+
+	while (open)
+	{
+		bool readable = connection.tls != nullptr && tlsHasPending(connection.tls);
+		bool peer_closed = false;
+		bool idle = false;
+
+		if (!readable)
+		{
+			// WSAEventSelect makes the socket non-blocking; it is switched back after the wait
+			// so reads and sends (plain or TLS) stay ordinary blocking calls
+			WSAEventSelect(connection.socket, socket_event, FD_READ | FD_CLOSE);
+			DWORD signaled = WSAWaitForMultipleEvents(2, events, FALSE, LIVE_HEARTBEAT_MS, FALSE);
+
+			WSANETWORKEVENTS network_events = {};
+			WSAEnumNetworkEvents(connection.socket, socket_event, &network_events);
+			WSAEventSelect(connection.socket, socket_event, 0);
+			setNonBlocking(connection.socket, false);
+
+			if (signaled == WSA_WAIT_FAILED)
+				break;
+
+			idle = signaled == WSA_WAIT_TIMEOUT;
+			readable = (network_events.lNetworkEvents & (FD_READ | FD_CLOSE)) != 0;
+			peer_closed = (network_events.lNetworkEvents & FD_CLOSE) != 0;
+		}
+
+		if (readable)
+		{
+			if (receiveInput(connection, context.max_request_size) <= 0)
+				break;
+
+			// Event-stream clients have nothing to say after the request
+			if (websocket)
+				open = processWebSocketInput(connection, context, channel, message);
+			else
+				connection.input.consume(connection.input.length());
+		}
+
+		// Hub messages are queued as references to the shared encoded bytes, never copied
+		if (!LiveHub::takePending(subscriber, messages) && open)
+		{
+			open = false;
+			if (websocket)
+				queueData(connection.output, encodeWebSocketClose(WS_CLOSE_GOING_AWAY));
+		}
+		for (const auto& encoded : messages)
+			queueSlice(connection.output, encoded, encoded->data(), encoded->length());
+		messages.clear();
+
+		// Heartbeats keep intermediaries from timing out the stream and expose dead peers
+		if (idle && open)
+		{
+			if (websocket)
+				queueData(connection.output, encodeWebSocketFrame(WS_PING, ""));
+			else
+				queueCopy(connection.output, ":\n\n", 3);
+		}
+
+		chargeClient(context, connection, connection.output.queued_bytes);
+		if (flushConnection(connection) < 0 || peer_closed)
+			break;
+	}
+
+	context.live->unsubscribe(channel, &subscriber);
+	WSACloseEvent(socket_event);
+	WSACloseEvent(subscriber.wake_event);
+
+	if (subscriber.dropped > 0)
+		std::cout << "[LIVE] " << channel << ": " << subscriber.dropped << " message(s) skipped for a slow subscriber" << std::endl;
+	std::cout << "[LIVE] Stream on " << channel << " closed" << std::endl;
+}
+
+void registerClient(ServerContext& context, SOCKET client_socket)
+{
+	std::lock_guard<std::mutex> lock(context.sockets_mutex);
+	context.client_sockets.insert(client_socket);
+	context.active_connections++;
+}
+
+void abortClients(ServerContext& context)
+{
+	// Shutdown wakes a blocked recv/send. The owning thread still closes the socket: closing it here
+	// would free the handle value for reuse while the thread may still send or recv on it.
+	std::lock_guard<std::mutex> lock(context.sockets_mutex);
+	for (SOCKET client_socket : context.client_sockets)
+		shutdown(client_socket, SD_BOTH);
+}
+
+// Closing a socket with unread input sends an RST, which can destroy the response before the
+// client reads it. Half-close instead, then read and discard until the client closes too.
+static void drainBeforeClose(Connection& connection)
+{
+	shutdown(connection.socket, SD_SEND);
+
+	DWORD timeout_ms = LINGER_CLOSE_MS;
+	setsockopt(connection.socket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout_ms, sizeof(timeout_ms));
+
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(LINGER_CLOSE_MS);
+	char discard[4096];
+	size_t drained = 0;
+	while (drained < LINGER_CLOSE_MAX_BYTES && std::chrono::steady_clock::now() < deadline)
+	{
+		int received = recv(connection.socket, discard, sizeof(discard), 0);
+		if (received <= 0)
+			break;
+		drained += received;
+	}
+}
+
+// Close the connection unless an overdue drain already has; linger when input was left unread
+static void closeClient(Connection& connection, ServerContext& context, bool linger = false)
+{
+	closeTls(connection.tls);
+	connection.tls = nullptr;
+	if (linger)
+		drainBeforeClose(connection);
+
+	std::lock_guard<std::mutex> lock(context.sockets_mutex);
+	if (context.client_sockets.erase(connection.socket) != 0)
+		closeSocket(connection.socket);
+}
+
+// Serves requests until the client closes, asks to close, or stays idle too long.
+// Pipelined requests already in the buffer are answered together with one flush.
+static void serveClient(SOCKET client_socket, const sockaddr_in& peer, ServerContext& context)
+{
+
+	Connection connection;
+	connection.socket = client_socket;
+	connection.peer = peer;
+	uint32_t peer_address = ntohl(peer.sin_addr.s_addr);
+
+	// Idle keep-alive connections must not hold their thread forever
+	DWORD timeout_ms = KEEP_ALIVE_TIMEOUT_MS;
+	setsockopt(client_socket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout_ms, sizeof(timeout_ms));
+
+	try
+	{
+		// The handshake runs under the same receive timeout, so a stalled client cannot hold the thread
+		if (context.tls != nullptr)
+		{
+			connection.tls = acceptTls(context.tls, client_socket);
+			if (connection.tls == nullptr)
+			{
+				closeClient(connection, context);
+				return;
+			}
+		}
+
+		bool keep_alive = true;
+		int requests_served = 0;
+		bool request_started = false;   // Tracing: the next request has begun (its first bytes arrived)
+		bool refused = false;           // A request was answered without reading all it sent
+
+		while (keep_alive)
+		{
+			std::string_view buffered = connection.input.view();
+			size_t request_end = findRequestEnd(buffered);
+
+			// A body that cannot be framed would be read as the next request: answer and close
+			if (request_end == REQUEST_BAD_LENGTH || request_end == REQUEST_UNSUPPORTED_ENCODING)
+			{
+				std::cout << "[HANDLER] Cannot frame request body: " << (request_end == REQUEST_BAD_LENGTH ? "bad Content-Length" : "Transfer-Encoding") << std::endl;
+				ResponseData response = request_end == REQUEST_BAD_LENGTH ?
+					generateErrorResponse(400, "Bad Request") : generateErrorResponse(501, "Not Implemented");
+				queueResponse(connection, response);
+				requests_served++;
+				refused = true;
+				break;
+			}
+
+			// Uploads wait for their head only; the body is streamed to disk afterwards
+			size_t head_end = isUploadRequestLine(buffered, context) ? findHeadEnd(buffered) : std::string::npos;
+			bool streamed_body = head_end != std::string::npos;
+			if (streamed_body)
+				request_end = head_end;
+
+			// STEP 1: No complete request buffered - flush what we have, then read more
+			if (request_end == std::string::npos)
+			{
+				if (flushConnection(connection) < 0)
+					break;
+
+				// Draining: an idle keep-alive connection is closed instead of waiting for another request
+				if (context.draining && requests_served > 0 && connection.input.empty())
+					break;
+
+				if (connection.input.length() >= context.max_request_size)
+				{
+					std::cout << "[HANDLER] Request is too large" << std::endl;
+					ResponseData response = generateErrorResponse(413, "Payload Too Large");
+					queueResponse(connection, response);
+					refused = true;
+					break;
+				}
+
+				// Between requests the connection gives its buffers back while it waits
+				if (connection.input.empty() && waitForInput(connection) <= 0)
+				{
+					if (requests_served == 0)
+						std::cout << "[HANDLER] Empty request received" << std::endl;
+					break;
+				}
+
+				// Idle time before the first bytes does not count towards the request
+				if (!request_started)
+				{
+					traceRequestStart();
+					request_started = true;
+				}
+
+				if (receiveInput(connection, context.max_request_size) <= 0)
+					break;
+				continue;
+			}
+
+			// A pipelined request was already buffered with the previous one
+			if (!request_started)
+				traceRequestStart();
+			request_started = false;
+
+			// A client over its rate limit gets the prepared 429 before its request is even parsed,
+			// and the connection closes
+			if (context.limiter != nullptr && !context.limiter->admitRequest(peer_address))
+			{
+				std::cout << "[HANDLER] Rate limit exceeded by " << formatAddress(connection.peer) << std::endl;
+				connection.input.consume(request_end);
+				queueSlice(connection.output, nullptr, TOO_MANY_REQUESTS, sizeof(TOO_MANY_REQUESTS) - 1);
+				requests_served++;
+				refused = true;
+				if (traceActive())
+					traceRequestEnd("(rate limited) 429");
+				break;
+			}
+
+			// STEP 2: Parse the request
+			std::string raw_request(connection.input.view().substr(0, request_end));
+			connection.input.consume(request_end);
+			RequestData request;
+			{
+				TraceSpan span("parse");
+				request = parseRequest(raw_request);
+			}
+			HTTP_TRACE_PROBE2(request_parsed, request.method.c_str(), request.path.c_str());
+
+			keep_alive = request.is_valid && wantsKeepAlive(request) && !context.draining;
+
+			// STEP 3a: Proxied prefixes stream the backend response straight to the client
+			UpstreamRoute* route = (request.is_valid && context.proxy != nullptr) ? context.proxy->matchRoute(request.path) : nullptr;
+			if (route != nullptr)
+			{
+				// Earlier pipelined responses must leave first
+				if (flushConnection(connection) < 0)
+					break;
+
+				TraceSpan proxy_span("proxy");
+				ResponseData error_response;
+				uint64_t proxied_bytes = 0;
+				bool forwarded = context.proxy->forwardRequest(*route, client_socket, connection.tls, request, keep_alive, error_response, proxied_bytes);
+				chargeClient(context, connection, proxied_bytes);
+				if (forwarded)
+				{
+					requests_served++;
+					if (traceActive())
+						traceRequestEnd(request.method + " " + request.path + " (proxied)");
+					continue;
+				}
+
+				setHeader(error_response, "Connection", "close");
+				queueChargedResponse(connection, context, error_response);
+				requests_served++;
+				break;
+			}
+
+			// STEP 3b: Live channels - POST publishes, GET subscribes (WebSocket upgrade or event stream)
+			std::string channel;
+			if (request.is_valid && context.live != nullptr && context.live->matchChannel(request.path, channel) &&
+				(request.method == "POST" || request.method == "GET"))
+			{
+				if (request.method == "POST")
+				{
+					ResponseData response;
+					{
+						TraceSpan span("publish");
+						response = publishToChannel(*context.live, channel, request);
+					}
+					setHeader(response, "Connection", keep_alive ? "keep-alive" : "close");
+					queueChargedResponse(connection, context, response);
+					requests_served++;
+					if (traceActive())
+						traceRequestEnd(request.method + " " + request.path + " 200");
+					continue;
+				}
+
+				if (flushConnection(connection) < 0)
+					break;
+
+				// The stream's lifetime is not part of the request
+				if (traceActive())
+					traceRequestEnd(request.method + " " + request.path + " (stream)");
+				traceRequestStop();
+
+				serveLiveStream(connection, context, request, channel);
+				requests_served++;
+				break;
+			}
+
+			// STEP 3c: Build the response from the site named by the Host header
+			ResponseData response = respondFromSite(request, context, keep_alive, streamed_body ? &connection : nullptr);
+			if (streamed_body && response.status_code >= 400)
+				refused = true;
+
+			// STEP 4: Queue the response; it is sent once no further pipelined request is waiting
+			std::cout << "[HANDLER] Queueing response (status " << response.status_code << ")..." << std::endl;
+			HTTP_TRACE_PROBE2(request_done, response.status_code, responseBody(response).length());
+			queueChargedResponse(connection, context, response);
+			requests_served++;
+
+			if (traceActive())
+				traceRequestEnd(request.method + " " + request.path + " " + std::to_string(response.status_code));
+		}
+
+		// STEP 5: Send whatever is still queued and close the connection
+		if (flushConnection(connection) < 0)
+			std::cout << "[HANDLER] Failed to send response" << std::endl;
+
+		std::cout << "[HANDLER] Served " << requests_served << " request(s), closing client connection..." << std::endl;
+		closeClient(connection, context, refused || !connection.input.empty());
+
+		std::cout << "[HANDLER] Client thread terminating" << std::endl;
+	}
+	catch (const std::exception& e)
+	{
+		std::cout << "[HANDLER] Exception in client handler: " << e.what() << std::endl;
+		closeClient(connection, context);
+	}
+	catch (...)
+	{
+		std::cout << "[HANDLER] Unknown exception in client handler" << std::endl;
+		closeClient(connection, context);
+	}
+}
+
+// Client handler function - runs in separate thread for each client
+void handleClient(SOCKET client_socket, const sockaddr_in& peer, ServerContext& context)
+{
+	std::cout << "[HANDLER] Client thread started for socket: " << client_socket << std::endl;
+	serveClient(client_socket, peer, context);
+
+	// Hand pooled buffers and trace events over now: once the count reaches zero main tears down shared state
+	releaseThreadBuffers();
+	flushThreadTrace();
+	context.active_connections--;
+}
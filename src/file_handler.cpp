@@ -1,66 +1,105 @@
 #include "file_handler.h"
+#include "mime_types.h"
+#include "tracing.h"
+#include "util.h"
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 #include <filesystem>
+#include <cwctype>
+#include <cstdlib>
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
 
 namespace fs = std::filesystem;
 
-// Constructor: Set the webroot directory
-FileHandler::FileHandler(const std::string& webroot) : webroot(webroot)
+// Bodies kept in the file cache; past the budget the least recently used are evicted.
+// Larger files are still read once per burst of concurrent requests, but not kept afterwards.
+const uintmax_t FILE_CACHE_MAX_BYTES = 64 * 1024 * 1024;
+const uintmax_t FILE_CACHE_MAX_FILE_SIZE = 4 * 1024 * 1024;
+
+// Change records read per wakeup of the webroot watcher; an overflow rescans anyway
+const DWORD WATCH_BUFFER_SIZE = 64 * 1024;
+
+// Replacing or deleting a file that is being read is retried this often, this far apart
+const int FILE_IN_USE_RETRIES = 20;
+const DWORD FILE_IN_USE_RETRY_MS = 50;
+
+// Numbers temp files, so concurrent uploads of one path never share a temp file
+static std::atomic<unsigned long long> next_upload_id(1);
+
+// Constructor: Set the webroot directory, scan it, and start watching it for changes
+// In bundle mode the bundle is only mapped; nothing is scanned or watched
+FileHandler::FileHandler(const std::string& webroot, const std::string& bundle_path) : webroot(webroot), watching(true)
 {
+	if (!bundle_path.empty())
+	{
+		bundle = AssetBundle::open(bundle_path);
+		if (bundle)
+		{
+			std::cout << "[FILE_HANDLER] Initialized with bundle: " << bundle_path << std::endl;
+			return;
+		}
+		std::cout << "[FILE_HANDLER] Falling back to webroot" << std::endl;
+	}
+
+	publishIndex(std::shared_ptr<const PathIndex>(buildPathIndex(webroot)));
+	watcher_thread = std::thread(&FileHandler::watchWebroot, this);
+
 	std::cout << "[FILE_HANDLER] Initialized with webroot: " << webroot << std::endl;
 }
 
-// Handle GET request: Maps path to file, reads it, returns response
+FileHandler::~FileHandler()
+{
+	watching = false;
+	if (watcher_thread.joinable())
+		watcher_thread.join();
+}
+
+// Handle GET request: Resolves path through the index, reads the file, returns response
 ResponseData FileHandler::handleGetRequest(const std::string& requested_path)
 {
-	// Map request path to actual file path
-	std::string file_path = mapPathToFile(requested_path);
+	std::string url_path;
+	FileEntry entry;
+	bool found;
+	{
+		TraceSpan span("resolve");
 
-	// Validate path (prevent directory traversal attacks)
-	if (!validateSecurityPath(file_path))
+		// Normalize the URL; ".." escaping the webroot is rejected before any lookup
+		url_path = normalizeUrlPath(requested_path);
+		found = !url_path.empty() && resolvePath(url_path, entry);
+	}
+
+	if (url_path.empty())
 	{
-		std::cout << "[FILE_HANDLER] Security violation: " << file_path << std::endl;
+		std::cout << "[FILE_HANDLER] Security violation: " << requested_path << std::endl;
 		return generateErrorResponse(403, "Forbidden: Access denied");
 	}
 
-	// Check if file exists
-	if (!fileExists(file_path))
+	// Resolve through the index: only files found under the webroot are servable
+	if (!found)
 	{
-		std::cout << "[FILE_HANDLER] File not found: " << file_path << std::endl;
+		std::cout << "[FILE_HANDLER] File not found: " << url_path << std::endl;
 		return generateErrorResponse(404, "Not Found");
 	}
 
-	// Try to read file
+	// Load the body; the response shares the cached buffer instead of copying it
 	try
 	{
-		std::string file_content = readFile(file_path);
-		std::cout << "[FILE_HANDLER] Served file: " << file_path << " (" << file_content.length() << " bytes)" << std::endl;
+		std::shared_ptr<const std::string> file_content = loadFile(entry);
+		std::cout << "[FILE_HANDLER] Served file: " << entry.file_path << " (" << file_content->length() << " bytes)" << std::endl;
 
 		// Build success response
 		ResponseData response;
 		response.status_code = 200;
 		response.reason_phrase = "OK";
-		response.body = file_content;
+		response.body_owner = file_content;
+		response.external_body = *file_content;
 
-		// Determine MIME type from filename
-		std::string mime_type = "application/octet-stream";
-		size_t dot_pos = file_path.find_last_of('.');
-		if (dot_pos != std::string::npos)
-		{
-			std::string ext = file_path.substr(dot_pos);
-			// Simple MIME type mapping
-			if (ext == ".html") mime_type = "text/html";
-			else if (ext == ".txt") mime_type = "text/plain";
-			else if (ext == ".css") mime_type = "text/css";
-			else if (ext == ".js") mime_type = "application/javascript";
-			else if (ext == ".json") mime_type = "application/json";
-			else if (ext == ".png") mime_type = "image/png";
-			else if (ext == ".jpg" || ext == ".jpeg") mime_type = "image/jpeg";
-		}
-
-		response.headers.push_back({"Content-Type", mime_type});
-		response.headers.push_back({"Content-Length", std::to_string(file_content.length())});
+		// MIME type was determined when the file was indexed
+		response.headers.push_back({"Content-Type", entry.mime_type});
+		response.headers.push_back({"Content-Length", std::to_string(file_content->length())});
 		response.headers.push_back({"Connection", "keep-alive"});
 		response.headers.push_back({"Server", "SimpleHTTPServer/1.0"});
 
@@ -73,6 +112,125 @@ ResponseData FileHandler::handleGetRequest(const std::string& requested_path)
 	}
 }
 
+// Handle GET request with its headers
+ResponseData FileHandler::handleGetRequest(const RequestData& request)
+{
+	if (bundle)
+		return serveFromBundle(request);
+
+	return handleGetRequest(request.path);
+}
+
+// If-None-Match: "*" or a list of entity tags, compared weakly (a W/ prefix is ignored)
+static bool etagListMatches(std::string_view header, std::string_view etag)
+{
+	size_t pos = 0;
+	while (pos < header.size())
+	{
+		char c = header[pos];
+		if (c == ' ' || c == '\t' || c == ',')
+		{
+			pos++;
+			continue;
+		}
+
+		if (c == '*')
+			return true;
+		if (header.compare(pos, 2, "W/") == 0)
+			pos += 2;
+
+		// A quoted tag may itself contain commas, so it ends only at the closing quote
+		if (pos >= header.size() || header[pos] != '"')
+			return false;
+		size_t close = header.find('"', pos + 1);
+		if (close == std::string_view::npos)
+			return false;
+
+		if (header.substr(pos, close + 1 - pos) == etag)
+			return true;
+		pos = close + 1;
+	}
+	return false;
+}
+
+// Accept-Encoding: gzip is used when it is listed, or covered by "*", with a q-value above zero.
+// An explicit gzip entry overrides "*"; x-gzip is the old alias of gzip.
+static bool acceptsGzip(const std::string& header)
+{
+	double gzip_q = -1;
+	double any_q = -1;
+	for (const std::string& item : split(header, ','))
+	{
+		std::vector<std::string> params = split(item, ';');
+		std::string coding = to_lowercase(trim(params[0]));
+		double q = 1.0;
+		for (size_t i = 1; i < params.size(); i++)
+		{
+			std::string param = to_lowercase(trim(params[i]));
+			if (param.compare(0, 2, "q=") == 0)
+				q = std::strtod(param.c_str() + 2, nullptr);
+		}
+
+		if (coding == "gzip" || coding == "x-gzip")
+			gzip_q = q;
+		else if (coding == "*")
+			any_q = q;
+	}
+	return gzip_q >= 0 ? gzip_q > 0 : any_q > 0;
+}
+
+// Serve a request straight from the mapped bundle pages
+// Head and body are views into the mapping; the response holds the mapping alive
+ResponseData FileHandler::serveFromBundle(const RequestData& request)
+{
+	std::string url_path;
+	BundleAsset asset;
+	bool found;
+	{
+		TraceSpan span("resolve");
+		url_path = normalizeUrlPath(request.path);
+		found = !url_path.empty() && bundle->find(url_path, asset);
+	}
+
+	if (url_path.empty())
+	{
+		std::cout << "[FILE_HANDLER] Security violation: " << request.path << std::endl;
+		return generateErrorResponse(403, "Forbidden: Access denied");
+	}
+
+	if (!found)
+	{
+		std::cout << "[FILE_HANDLER] File not found in bundle: " << url_path << std::endl;
+		return generateErrorResponse(404, "Not Found");
+	}
+
+	ResponseData response;
+	bool use_gzip = !asset.gzip_head.empty() && acceptsGzip(getHeader(request, "accept-encoding"));
+
+	// Conditional request: the client already has the variant that would be sent
+	std::string gzip_etag = use_gzip ? gzipEtag(asset.etag) : std::string();
+	std::string_view etag = use_gzip ? std::string_view(gzip_etag) : asset.etag;
+	if (etagListMatches(findHeader(request, "if-none-match"), etag))
+	{
+		response.status_code = 304;
+		response.reason_phrase = "Not Modified";
+		response.headers.push_back({"ETag", std::string(etag)});
+		if (!asset.gzip_head.empty())
+			response.headers.push_back({"Vary", "Accept-Encoding"});
+		response.headers.push_back({"Server", "SimpleHTTPServer/1.0"});
+		return response;
+	}
+
+	response.status_code = 200;
+	response.reason_phrase = "OK";
+	response.body_owner = bundle->mapping();
+	response.precomputed_head = use_gzip ? asset.gzip_head : asset.head;
+	response.external_body = use_gzip ? asset.gzip_body : asset.body;
+
+	std::cout << "[FILE_HANDLER] Served from bundle: " << url_path << (use_gzip ? " (gzip)" : "") << std::endl;
+	return response;
+}
+
 // Read entire file content into string
 std::string FileHandler::readFile(const std::string& file_path)
 {
@@ -95,19 +253,88 @@ std::string FileHandler::readFile(const std::string& file_path)
 	return content;
 }
 
-// Check if file exists and is a regular file (not directory)
-bool FileHandler::fileExists(const std::string& file_path)
+// Shared file body from the cache, read at most once per version however many requests miss together
+std::shared_ptr<const std::string> FileHandler::loadFile(const FileEntry& entry)
 {
+	std::promise<std::shared_ptr<const std::string>> loaded;
+	std::shared_future<std::shared_ptr<const std::string>> body;
+	unsigned long long load_id = 0;
+	bool retain = false;
+
+	{
+		std::lock_guard<std::mutex> lock(cache_mutex);
+
+		auto it = file_cache.find(entry.file_path);
+		if (it != file_cache.end() && it->second.size == entry.size && it->second.mtime == entry.mtime)
+		{
+			body = it->second.body;
+			cache_lru.splice(cache_lru.begin(), cache_lru, it->second.lru_position);
+		}
+		else
+		{
+			// Miss or stale version: this request becomes the loader, later ones wait on its future
+			if (it != file_cache.end())
+				eraseCachedFile(entry.file_path);
+
+			// Make room by evicting the least recently used bodies; their current readers keep them alive
+			retain = entry.size <= FILE_CACHE_MAX_FILE_SIZE;
+			while (retain && file_cache_bytes + entry.size > FILE_CACHE_MAX_BYTES && !cache_lru.empty())
+				eraseCachedFile(cache_lru.back());
+
+			body = loaded.get_future().share();
+			load_id = ++next_load_id;
+			cache_lru.push_front(entry.file_path);
+			file_cache[entry.file_path] = {entry.size, entry.mtime, body, load_id, cache_lru.begin()};
+			file_cache_bytes += entry.size;
+		}
+	}
+
+	// Waiters block here until the loader has finished; a failed read is rethrown to all of them
+	if (load_id == 0)
+	{
+		TraceSpan span("cache_wait");
+		return body.get();
+	}
+
+	bool failed = false;
 	try
 	{
-		fs::path p(file_path);
-		return fs::exists(p) && fs::is_regular_file(p);
+		TraceSpan span("read_file");
+		loaded.set_value(std::make_shared<const std::string>(readFile(entry.file_path)));
 	}
-	catch (const std::exception& e)
+	catch (...)
 	{
-		std::cout << "[FILE_HANDLER] Error checking file: " << e.what() << std::endl;
-		return false;
+		loaded.set_exception(std::current_exception());
+		failed = true;
+	}
+
+	// Failed reads and files over the budget are shared only while the read is in flight
+	if (failed || !retain)
+	{
+		std::lock_guard<std::mutex> lock(cache_mutex);
+		auto it = file_cache.find(entry.file_path);
+		if (it != file_cache.end() && it->second.load_id == load_id)
+			eraseCachedFile(entry.file_path);
 	}
+
+	return body.get();
+}
+
+// Resolve a request path through the current index snapshot
+bool FileHandler::resolvePath(const std::string& request_path, FileEntry& entry)
+{
+	// The reference keeps the snapshot alive however long this thread is descheduled here
+	std::shared_ptr<const PathIndex> index = std::atomic_load(&current_index);
+	if (!index)
+		return false;
+
+	auto it = index->entries.find(request_path);
+	if (it == index->entries.end())
+		return false;
+
+	// Copy out so the snapshot is not held past this lookup
+	entry = it->second;
+	return true;
 }
 
 // Map request path like "/index.html" to actual filesystem path
@@ -116,13 +343,7 @@ std::string FileHandler::mapPathToFile(const std::string& request_path)
 	// Combine webroot with request path
 	// Example: webroot="webroot", request_path="/index.html" -> "webroot/index.html"
 
-	std::string file_path = webroot;
-
-	// Ensure webroot ends with separator
-	if (file_path.back() != '\\' && file_path.back() != '/')
-	{
-		file_path += '\\';
-	}
+	fs::path file_path(webroot);
 
 	// Remove leading slash from request path
 	std::string clean_path = request_path;
@@ -137,9 +358,10 @@ std::string FileHandler::mapPathToFile(const std::string& request_path)
 		clean_path = "index.html";
 	}
 
-	file_path += clean_path;
+	// operator/ inserts the platform separator
+	file_path /= clean_path;
 
-	return file_path;
+	return file_path.string();
 }
 
 // Validate that path is within webroot (prevent directory traversal attacks)
@@ -147,21 +369,16 @@ bool FileHandler::validateSecurityPath(const std::string& file_path)
 {
 	try
 	{
-		// Get absolute (canonical) paths
-		fs::path webroot_abs = fs::absolute(webroot);
-		fs::path file_abs = fs::absolute(file_path);
+		// Get absolute, lexically normalized paths ("a/../b" -> "b")
+		fs::path webroot_abs = fs::absolute(webroot).lexically_normal();
+		fs::path file_abs = fs::absolute(file_path).lexically_normal();
 
-		// Check if file path starts with webroot path
+		// Check that every component of the webroot prefixes the file path
 		// This prevents ../ attacks that try to escape the webroot
-		std::string file_str = file_abs.string();
-		std::string webroot_str = webroot_abs.string();
+		auto mismatch = std::mismatch(webroot_abs.begin(), webroot_abs.end(), file_abs.begin(), file_abs.end());
 
-		// Ensure webroot ends with separator for proper prefix check
-		if (webroot_str.back() != '\\')
-			webroot_str += '\\';
-
-		// Check if file path starts with webroot path
-		return file_str.find(webroot_str) == 0;
+		// A trailing separator leaves an empty final component on the webroot
+		return mismatch.first == webroot_abs.end() || (mismatch.first->empty() && std::next(mismatch.first) == webroot_abs.end());
 	}
 	catch (const std::exception& e)
 	{
@@ -169,3 +386,382 @@ bool FileHandler::validateSecurityPath(const std::string& file_path)
 		return false;
 	}
 }
+
+// Windows refuses to replace or delete a file while a reader has it open;
+// reads are short, so the operation is retried for a moment before giving up
+template <typename Operation>
+static bool retryWhileInUse(Operation operation)
+{
+	for (int attempt = 0; ; attempt++)
+	{
+		if (operation())
+			return true;
+
+		DWORD error = GetLastError();
+		if ((error != ERROR_SHARING_VIOLATION && error != ERROR_ACCESS_DENIED) || attempt == FILE_IN_USE_RETRIES)
+			return false;
+		Sleep(FILE_IN_USE_RETRY_MS);
+	}
+}
+
+// Start an upload: validate the target, then create and preallocate its temp file
+ResponseData FileHandler::beginUpload(const std::string& request_path, uint64_t content_length, PendingUpload& upload)
+{
+	if (bundle)
+		return generateErrorResponse(405, "Method Not Allowed");
+
+	upload.url_path = normalizeUrlPath(request_path);
+	if (upload.url_path.empty() || isUploadTempFile(upload.url_path) || !isPlainFilePath(upload.url_path))
+	{
+		std::cout << "[FILE_HANDLER] Security violation: " << request_path << std::endl;
+		return generateErrorResponse(403, "Forbidden: Access denied");
+	}
+	upload.url_path = diskCaseUrlPath(upload.url_path);
+
+	upload.file_path = mapPathToFile(upload.url_path);
+	if (!validateSecurityPath(upload.file_path))
+		return generateErrorResponse(403, "Forbidden: Access denied");
+
+	// A directory cannot be replaced by a file, nor a file be used as a directory
+	std::error_code ec;
+	fs::path target(upload.file_path);
+	fs::create_directories(target.parent_path(), ec);
+	if (ec || fs::is_directory(fs::symlink_status(target, ec)))
+	{
+		std::cout << "[FILE_HANDLER] Upload target conflicts with the webroot layout: " << upload.url_path << std::endl;
+		return generateErrorResponse(409, "Conflict");
+	}
+
+	// Same directory as the target, so the final rename never crosses volumes
+	std::string temp_path = upload.file_path + "." + std::to_string(next_upload_id++) + UPLOAD_TEMP_SUFFIX;
+	upload.file = CreateFileA(temp_path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (upload.file == INVALID_HANDLE_VALUE)
+	{
+		std::cout << "[FILE_HANDLER] Cannot create " << temp_path << ": " << GetLastError() << std::endl;
+		return generateErrorResponse(500, "Internal Server Error");
+	}
+	upload.temp_path = temp_path;
+	upload.expected = content_length;
+	upload.written = 0;
+
+	// Reserve the whole size up front: the file is laid out in one piece, and a full disk
+	// is reported before the body is read rather than halfway through it
+	if (content_length > 0)
+	{
+		FILE_ALLOCATION_INFO allocation;
+		allocation.AllocationSize.QuadPart = static_cast<LONGLONG>(content_length);
+		if (!SetFileInformationByHandle(upload.file, FileAllocationInfo, &allocation, sizeof(allocation)) &&
+			GetLastError() == ERROR_DISK_FULL)
+		{
+			std::cout << "[FILE_HANDLER] No space for a " << content_length << " byte upload to " << upload.url_path << std::endl;
+			abortUpload(upload);
+			return generateErrorResponse(507, "Insufficient Storage");
+		}
+	}
+
+	std::cout << "[FILE_HANDLER] Receiving upload: " << upload.url_path << " (" << content_length << " bytes)" << std::endl;
+
+	ResponseData accepted;
+	accepted.status_code = 0;
+	return accepted;
+}
+
+// Append the next part of the body to the temp file
+bool FileHandler::writeUpload(PendingUpload& upload, const char* data, size_t length)
+{
+	DWORD written = 0;
+	if (!WriteFile(upload.file, data, static_cast<DWORD>(length), &written, nullptr) || written != length)
+	{
+		std::cout << "[FILE_HANDLER] Write to " << upload.temp_path << " failed: " << GetLastError() << std::endl;
+		return false;
+	}
+
+	upload.written += written;
+	return true;
+}
+
+// Move the complete temp file into place
+// The rename replaces the target in one step: readers see the old file or the new one, never a mix.
+ResponseData FileHandler::finishUpload(PendingUpload& upload)
+{
+	// Flushed before the rename, so a crash cannot leave a published but truncated file
+	bool flushed = FlushFileBuffers(upload.file) != 0;
+	CloseHandle(upload.file);
+	upload.file = INVALID_HANDLE_VALUE;
+
+	std::error_code ec;
+	bool replaced = fs::is_regular_file(fs::symlink_status(upload.file_path, ec));
+
+	if (!flushed || !retryWhileInUse([&] { return MoveFileExA(upload.temp_path.c_str(), upload.file_path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0; }))
+	{
+		std::cout << "[FILE_HANDLER] Cannot publish upload " << upload.url_path << ": " << GetLastError() << std::endl;
+		upload.discard();
+		return generateErrorResponse(500, "Internal Server Error");
+	}
+
+	upload.temp_path.clear();
+
+	// Visible to the next request right away instead of after the watcher's rescan
+	FileEntry entry;
+	entry.file_path = upload.file_path;
+	entry.mime_type = std::string(lookupMimeType(upload.file_path));
+	entry.size = upload.written;
+	entry.mtime = fs::last_write_time(upload.file_path, ec);
+	updateIndexEntry(upload.url_path, &entry);
+
+	std::cout << "[FILE_HANDLER] Stored upload: " << upload.file_path << " (" << upload.written << " bytes)" << std::endl;
+
+	ResponseData response;
+	if (replaced)
+	{
+		response.status_code = 204;
+		response.reason_phrase = "No Content";
+	}
+	else
+	{
+		response.status_code = 201;
+		response.reason_phrase = "Created";
+		response.headers.push_back({"Location", upload.url_path});
+		response.headers.push_back({"Content-Length", "0"});
+	}
+	return response;
+}
+
+void PendingUpload::discard()
+{
+	if (file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(file);
+		file = INVALID_HANDLE_VALUE;
+	}
+
+	if (!temp_path.empty())
+	{
+		DeleteFileA(temp_path.c_str());
+		temp_path.clear();
+	}
+}
+
+// Discard an upload that did not complete
+void FileHandler::abortUpload(PendingUpload& upload)
+{
+	upload.discard();
+	std::cout << "[FILE_HANDLER] Upload to " << upload.url_path << " abandoned after " << upload.written << " of " << upload.expected << " bytes" << std::endl;
+}
+
+// Delete the file behind request_path and remove it from the index and cache
+ResponseData FileHandler::deleteFile(const std::string& request_path)
+{
+	if (bundle)
+		return generateErrorResponse(405, "Method Not Allowed");
+
+	std::string url_path = normalizeUrlPath(request_path);
+	if (url_path.empty() || isUploadTempFile(url_path) || !isPlainFilePath(url_path))
+	{
+		std::cout << "[FILE_HANDLER] Security violation: " << request_path << std::endl;
+		return generateErrorResponse(403, "Forbidden: Access denied");
+	}
+	url_path = diskCaseUrlPath(url_path);
+
+	std::string file_path = mapPathToFile(url_path);
+	if (!validateSecurityPath(file_path))
+		return generateErrorResponse(403, "Forbidden: Access denied");
+
+	// Only regular files: links and directories are never touched
+	std::error_code ec;
+	if (!fs::is_regular_file(fs::symlink_status(file_path, ec)))
+		return generateErrorResponse(404, "Not Found");
+
+	if (!retryWhileInUse([&] { return DeleteFileA(file_path.c_str()) != 0; }))
+	{
+		std::cout << "[FILE_HANDLER] Cannot delete " << file_path << ": " << GetLastError() << std::endl;
+		return generateErrorResponse(500, "Internal Server Error");
+	}
+
+	updateIndexEntry(url_path, nullptr);
+	std::cout << "[FILE_HANDLER] Deleted file: " << file_path << std::endl;
+
+	ResponseData response;
+	response.status_code = 204;
+	response.reason_phrase = "No Content";
+	return response;
+}
+
+std::string FileHandler::diskCaseUrlPath(const std::string& url_path)
+{
+	std::string result;
+	fs::path directory(webroot);
+	bool on_disk = true;   // Every segment so far exists; the rest will be created as spelled
+
+	size_t pos = 0;
+	while (pos < url_path.length())
+	{
+		size_t next = url_path.find('/', pos + 1);
+		if (next == std::string::npos)
+			next = url_path.length();
+		std::string segment = url_path.substr(pos + 1, next - pos - 1);
+		pos = next;
+
+		// Uploads and deletes are rare, so listing each directory on the way is cheap enough
+		if (on_disk)
+		{
+			std::string wanted = to_lowercase(segment);
+			std::string match;
+			std::error_code ec;
+			for (fs::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec))
+			{
+				std::string name = it->path().filename().string();
+				if (name == segment || (match.empty() && to_lowercase(name) == wanted))
+					match = name;
+				if (name == segment)
+					break;
+			}
+
+			on_disk = !match.empty();
+			if (on_disk)
+				segment = match;
+			directory /= segment;
+		}
+
+		result += '/';
+		result += segment;
+	}
+	return result;
+}
+
+// Rescan the webroot and publish a new index snapshot
+void FileHandler::rebuildIndex()
+{
+	publishIndex(std::shared_ptr<const PathIndex>(buildPathIndex(webroot)));
+}
+
+// Publish a new snapshot; readers still inside a lookup keep the old one alive
+void FileHandler::publishIndex(std::shared_ptr<const PathIndex> index)
+{
+	std::lock_guard<std::mutex> lock(publish_mutex);
+	std::atomic_store(&current_index, std::move(index));
+
+	// A rescan means files changed; drop cached bodies so deleted files do not linger.
+	// Requests already holding a body keep it alive until they finish sending.
+	std::lock_guard<std::mutex> cache_lock(cache_mutex);
+	file_cache.clear();
+	cache_lru.clear();
+	file_cache_bytes = 0;
+}
+
+// Publish a copy of the current snapshot with one entry changed
+// Copying under publish_mutex keeps a concurrent rescan or upload from being lost.
+void FileHandler::updateIndexEntry(const std::string& url_path, const FileEntry* entry)
+{
+	std::lock_guard<std::mutex> lock(publish_mutex);
+
+	std::shared_ptr<const PathIndex> current = std::atomic_load(&current_index);
+	auto index = current ? std::make_shared<PathIndex>(*current) : std::make_shared<PathIndex>();
+	std::string file_path = mapPathToFile(url_path);
+
+	auto it = index->entries.find(url_path);
+	if (it != index->entries.end())
+	{
+		file_path = it->second.file_path;
+		index->entries.erase(it);
+	}
+	if (entry != nullptr)
+		index->entries.emplace(url_path, *entry);
+
+	std::atomic_store(&current_index, std::shared_ptr<const PathIndex>(std::move(index)));
+
+	std::lock_guard<std::mutex> cache_lock(cache_mutex);
+	eraseCachedFile(file_path);
+}
+
+// Drop one cached body; a path not in the cache is ignored
+void FileHandler::eraseCachedFile(const std::string& file_path)
+{
+	auto it = file_cache.find(file_path);
+	if (it == file_cache.end())
+		return;
+
+	file_cache_bytes -= it->second.size;
+	cache_lru.erase(it->second.lru_position);
+	file_cache.erase(it);
+}
+
+// Whether a batch of change records touches anything but upload temp files
+static bool hasIndexChange(const char* records, DWORD length)
+{
+	// No records means the buffer overflowed and the changes are unknown
+	if (length == 0)
+		return true;
+
+	// Case-insensitive like isUploadTempFile; the suffix itself is lowercase
+	size_t suffix_length = sizeof(UPLOAD_TEMP_SUFFIX) - 1;
+	DWORD offset = 0;
+	while (true)
+	{
+		const FILE_NOTIFY_INFORMATION* record = (const FILE_NOTIFY_INFORMATION*)(records + offset);
+		size_t name_length = record->FileNameLength / sizeof(WCHAR);
+		bool temp_file = name_length >= suffix_length;
+		for (size_t i = 0; temp_file && i < suffix_length; i++)
+			temp_file = std::towlower(record->FileName[name_length - suffix_length + i]) == (WCHAR)UPLOAD_TEMP_SUFFIX[i];
+
+		if (!temp_file)
+			return true;
+		if (record->NextEntryOffset == 0)
+			return false;
+		offset += record->NextEntryOffset;
+	}
+}
+
+// Background thread: rebuild the index whenever files under the webroot change.
+// Upload temp files are ignored, so a long upload does not rescan (and clear the cache) on every write.
+void FileHandler::watchWebroot()
+{
+	HANDLE directory = CreateFileA(webroot.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+
+	if (directory == INVALID_HANDLE_VALUE)
+	{
+		std::cout << "[FILE_HANDLER] Cannot watch webroot, index will not refresh: " << GetLastError() << std::endl;
+		return;
+	}
+
+	const DWORD filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE;
+	std::vector<DWORD> records(WATCH_BUFFER_SIZE / sizeof(DWORD));   // Change records must be DWORD-aligned
+	OVERLAPPED overlapped = {};
+	overlapped.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+	bool armed = overlapped.hEvent != nullptr &&
+		ReadDirectoryChangesW(directory, records.data(), WATCH_BUFFER_SIZE, TRUE, filter, nullptr, &overlapped, nullptr);
+
+	while (watching && armed)
+	{
+		// Wake periodically so the destructor can stop the thread
+		if (WaitForSingleObject(overlapped.hEvent, 500) != WAIT_OBJECT_0)
+			continue;
+
+		DWORD length = 0;
+		if (!GetOverlappedResult(directory, &overlapped, &length, FALSE))
+			break;
+		bool changed = hasIndexChange((const char*)records.data(), length);
+
+		// Re-arm first so changes made during the rescan trigger another one
+		ResetEvent(overlapped.hEvent);
+		armed = ReadDirectoryChangesW(directory, records.data(), WATCH_BUFFER_SIZE, TRUE, filter, nullptr, &overlapped, nullptr);
+
+		// Let a burst of changes (e.g. a deploy copying many files) settle before rescanning
+		if (changed)
+		{
+			Sleep(100);
+			rebuildIndex();
+		}
+	}
+
+	if (armed)
+	{
+		CancelIoEx(directory, &overlapped);
+		DWORD length = 0;
+		GetOverlappedResult(directory, &overlapped, &length, TRUE);
+	}
+	if (overlapped.hEvent != nullptr)
+		CloseHandle(overlapped.hEvent);
+	CloseHandle(directory);
+}
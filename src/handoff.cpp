@@ -0,0 +1,282 @@
+#include "handoff.h"
+#include "server.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cctype>
+#include <algorithm>
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <iphlpapi.h>
+
+static sockaddr_in loopbackAddress(int port)
+{
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	return address;
+}
+
+static void setControlTimeouts(SOCKET control_socket)
+{
+	DWORD timeout_ms = HANDOFF_TIMEOUT_MS;
+	setsockopt(control_socket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout_ms, sizeof(timeout_ms));
+	setsockopt(control_socket, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout_ms, sizeof(timeout_ms));
+}
+
+// Read exactly length bytes
+static bool receiveExact(SOCKET control_socket, char* data, size_t length)
+{
+	size_t received = 0;
+	while (received < length)
+	{
+		int result = recv(control_socket, data + received, static_cast<int>(length - received), 0);
+		if (result <= 0)
+			return false;
+		received += result;
+	}
+	return true;
+}
+
+// Process owning the client end of an accepted loopback connection, 0 if it cannot be found
+static DWORD connectionOwner(SOCKET control_socket, const sockaddr_in& peer)
+{
+	sockaddr_in local = {};
+	int local_length = sizeof(local);
+	if (getsockname(control_socket, (sockaddr*)&local, &local_length) == SOCKET_ERROR)
+		return 0;
+
+	// The table may grow between asking for its size and reading it
+	std::vector<char> table;
+	DWORD size = 0;
+	DWORD result = ERROR_INSUFFICIENT_BUFFER;
+	while (result == ERROR_INSUFFICIENT_BUFFER)
+	{
+		table.resize(size);
+		result = GetExtendedTcpTable(table.empty() ? nullptr : table.data(), &size, FALSE, AF_INET, TCP_TABLE_OWNER_PID_CONNECTIONS, 0);
+	}
+	if (result != NO_ERROR)
+		return 0;
+
+	// The peer's row has the two endpoints swapped; ports sit in the low 16 bits in network order
+	const MIB_TCPTABLE_OWNER_PID* rows = (const MIB_TCPTABLE_OWNER_PID*)table.data();
+	for (DWORD i = 0; i < rows->dwNumEntries; i++)
+	{
+		const MIB_TCPROW_OWNER_PID& row = rows->table[i];
+		if (row.dwLocalAddr == peer.sin_addr.s_addr && (u_short)row.dwLocalPort == peer.sin_port &&
+			row.dwRemoteAddr == local.sin_addr.s_addr && (u_short)row.dwRemotePort == local.sin_port)
+			return row.dwOwningPid;
+	}
+	return 0;
+}
+
+// Executable path (lowercase) and user SID of a process
+static bool processIdentity(HANDLE process, std::string& image, std::vector<char>& user_sid)
+{
+	char path[MAX_PATH];
+	DWORD path_length = MAX_PATH;
+	if (!QueryFullProcessImageNameA(process, 0, path, &path_length))
+		return false;
+	image.assign(path, path_length);
+	std::transform(image.begin(), image.end(), image.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+	HANDLE token;
+	if (!OpenProcessToken(process, TOKEN_QUERY, &token))
+		return false;
+
+	// TOKEN_USER is followed by the SID it points to
+	union {
+		TOKEN_USER user;
+		char bytes[256];
+	} token_user;
+	DWORD length = 0;
+	BOOL found = GetTokenInformation(token, TokenUser, &token_user, sizeof(token_user), &length);
+	CloseHandle(token);
+	if (!found)
+		return false;
+
+	const char* sid = (const char*)token_user.user.User.Sid;
+	user_sid.assign(sid, sid + GetLengthSid(token_user.user.User.Sid));
+	return true;
+}
+
+// Whether process_id runs the same executable as this process, under the same user
+static bool isSameServer(DWORD process_id)
+{
+	HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, process_id);
+	if (process == nullptr)
+		return false;
+
+	std::string image, own_image;
+	std::vector<char> user_sid, own_user_sid;
+	bool same = processIdentity(process, image, user_sid) &&
+		processIdentity(GetCurrentProcess(), own_image, own_user_sid) &&
+		image == own_image && user_sid == own_user_sid;
+	CloseHandle(process);
+	return same;
+}
+
+// Compare without stopping at the first difference, so the reply time does not reveal a prefix
+static bool secretsMatch(const std::string& given, const std::string& expected)
+{
+	unsigned char difference = given.length() != expected.length();
+	for (size_t i = 0; i < given.length() && i < expected.length(); i++)
+		difference |= given[i] ^ expected[i];
+	return difference == 0;
+}
+
+SOCKET receiveListeningSocket(int handoff_port, const std::string& secret)
+{
+	WSADATA wsaData;
+	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+		return INVALID_SOCKET;
+
+	SOCKET control_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (control_socket == INVALID_SOCKET)
+		return INVALID_SOCKET;
+	setControlTimeouts(control_socket);
+
+	// Nobody listening means there is no running server to take over from
+	sockaddr_in address = loopbackAddress(handoff_port);
+	if (connect(control_socket, (const sockaddr*)&address, sizeof(address)) == SOCKET_ERROR)
+	{
+		closesocket(control_socket);
+		return INVALID_SOCKET;
+	}
+
+	std::cout << "[HANDOFF] Found running server on control port " << handoff_port << ", requesting its listening socket..." << std::endl;
+
+	WSAPROTOCOL_INFOA protocol_info;
+	std::string request = "HANDOFF " + std::to_string(GetCurrentProcessId()) + " " + secret + "\n";
+	if (sendData(control_socket, request) < 0 || !receiveExact(control_socket, (char*)&protocol_info, sizeof(protocol_info)))
+	{
+		std::cout << "[HANDOFF] Running server did not hand over its socket" << std::endl;
+		closesocket(control_socket);
+		return INVALID_SOCKET;
+	}
+
+	SOCKET listening_socket = WSASocketA(FROM_PROTOCOL_INFO, FROM_PROTOCOL_INFO, FROM_PROTOCOL_INFO, &protocol_info, 0, 0);
+	if (listening_socket == INVALID_SOCKET)
+	{
+		std::cout << "[HANDOFF] Cannot open duplicated socket: " << WSAGetLastError() << std::endl;
+		closesocket(control_socket);
+		return INVALID_SOCKET;
+	}
+
+	// Confirm last: until then the old process keeps accepting on its own copy
+	if (sendData(control_socket, "OK") < 0)
+	{
+		closesocket(listening_socket);
+		closesocket(control_socket);
+		return INVALID_SOCKET;
+	}
+
+	closesocket(control_socket);
+	std::cout << "[HANDOFF] Took over listening socket" << std::endl;
+	return listening_socket;
+}
+
+SOCKET openHandoffListener(int handoff_port)
+{
+	SOCKET control_listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (control_listener == INVALID_SOCKET)
+		return INVALID_SOCKET;
+
+	// The previous process releases the port right after handing off, so give it a moment
+	sockaddr_in address = loopbackAddress(handoff_port);
+	int waited_ms = 0;
+	while (bind(control_listener, (const sockaddr*)&address, sizeof(address)) == SOCKET_ERROR)
+	{
+		if (waited_ms >= HANDOFF_BIND_RETRY_MS)
+		{
+			std::cout << "[HANDOFF] Cannot bind control port " << handoff_port << ": " << WSAGetLastError() << std::endl;
+			closesocket(control_listener);
+			return INVALID_SOCKET;
+		}
+		Sleep(100);
+		waited_ms += 100;
+	}
+
+	if (listen(control_listener, 1) == SOCKET_ERROR)
+	{
+		std::cout << "[HANDOFF] Cannot listen on control port " << handoff_port << ": " << WSAGetLastError() << std::endl;
+		closesocket(control_listener);
+		return INVALID_SOCKET;
+	}
+
+	std::cout << "[HANDOFF] Control port listening on 127.0.0.1:" << handoff_port << std::endl;
+	return control_listener;
+}
+
+bool serveHandoff(SOCKET control_listener, SOCKET listening_socket, const std::string& secret)
+{
+	sockaddr_in peer = {};
+	int peer_length = sizeof(peer);
+	SOCKET control_socket = accept(control_listener, (sockaddr*)&peer, &peer_length);
+	if (control_socket == INVALID_SOCKET)
+		return false;
+	setControlTimeouts(control_socket);
+
+	// Request: "HANDOFF <pid> <secret>\n"
+	std::string request;
+	while (request.find('\n') == std::string::npos && request.length() < HANDOFF_MAX_REQUEST)
+	{
+		if (receiveChunk(control_socket, request) <= 0)
+			break;
+	}
+
+	unsigned long process_id = 0;
+	std::string given_secret;
+	size_t line_end = request.find('\n');
+	if (request.compare(0, 8, "HANDOFF ") == 0 && line_end != std::string::npos)
+	{
+		std::string line = request.substr(8, line_end - 8);
+		size_t space = line.find(' ');
+		process_id = std::strtoul(line.substr(0, space).c_str(), nullptr, 10);
+		if (space != std::string::npos)
+			given_secret = line.substr(space + 1);
+	}
+
+	if (process_id == 0)
+	{
+		std::cout << "[HANDOFF] Ignoring malformed control request" << std::endl;
+		closesocket(control_socket);
+		return false;
+	}
+
+	// Only the process at the other end of this connection, running this server as this user,
+	// may take the socket; with handoff_secret set it must also know the secret
+	if (!secretsMatch(given_secret, secret) || connectionOwner(control_socket, peer) != process_id || !isSameServer(process_id))
+	{
+		std::cout << "[HANDOFF] Refusing handoff to process " << process_id << ": not this server or wrong secret" << std::endl;
+		closesocket(control_socket);
+		return false;
+	}
+
+	WSAPROTOCOL_INFOA protocol_info;
+	if (WSADuplicateSocketA(listening_socket, process_id, &protocol_info) == SOCKET_ERROR)
+	{
+		std::cout << "[HANDOFF] Cannot duplicate listening socket for process " << process_id << ": " << WSAGetLastError() << std::endl;
+		closesocket(control_socket);
+		return false;
+	}
+
+	char reply[2];
+	bool confirmed = sendData(control_socket, std::string((const char*)&protocol_info, sizeof(protocol_info))) >= 0 &&
+		receiveExact(control_socket, reply, sizeof(reply)) && reply[0] == 'O' && reply[1] == 'K';
+
+	// Let the new process close first: the side that closes first keeps the port in TIME_WAIT,
+	// and this port is the one the new process binds next
+	if (confirmed)
+		recv(control_socket, reply, sizeof(reply), 0);
+	closesocket(control_socket);
+
+	if (confirmed)
+		std::cout << "[HANDOFF] Listening socket handed to process " << process_id << std::endl;
+	else
+		std::cout << "[HANDOFF] Process " << process_id << " did not confirm, keep serving" << std::endl;
+	return confirmed;
+}
@@ -0,0 +1,190 @@
+#include "live_hub.h"
+#include "websocket.h"
+#include <iostream>
+#include <algorithm>
+
+LiveHub::LiveHub(const std::string& path_prefix, size_t max_pending_bytes, SlowConsumerPolicy policy)
+	: prefix(path_prefix), max_pending_bytes(max_pending_bytes), policy(policy)
+{
+	std::cout << "[LIVE] Channels under " << prefix << " (queue limit " << max_pending_bytes << " bytes, slow consumers are "
+		<< (policy == SlowConsumerPolicy::Drop ? "skipped" : "disconnected") << ")" << std::endl;
+}
+
+bool LiveHub::matchChannel(const std::string& path, std::string& channel) const
+{
+	if (path.compare(0, prefix.length(), prefix) != 0)
+		return false;
+
+	size_t end = std::min(path.find('?'), path.length());
+	if (end <= prefix.length())
+		return false;
+
+	channel = path.substr(prefix.length(), end - prefix.length());
+	return true;
+}
+
+void LiveHub::subscribe(const std::string& channel_name, LiveSubscriber* subscriber)
+{
+	std::lock_guard<std::mutex> lock(channels_mutex);
+	std::shared_ptr<Channel>& channel = channels[channel_name];
+	if (!channel)
+		channel = std::make_shared<Channel>();
+
+	std::lock_guard<std::mutex> channel_lock(channel->mutex);
+	channel->subscribers.push_back(subscriber);
+
+	if (closed)
+	{
+		std::lock_guard<std::mutex> subscriber_lock(subscriber->mutex);
+		subscriber->closing = true;
+		WSASetEvent(subscriber->wake_event);
+	}
+}
+
+void LiveHub::unsubscribe(const std::string& channel_name, LiveSubscriber* subscriber)
+{
+	std::lock_guard<std::mutex> lock(channels_mutex);
+	auto it = channels.find(channel_name);
+	if (it == channels.end())
+		return;
+
+	std::lock_guard<std::mutex> channel_lock(it->second->mutex);
+	std::vector<LiveSubscriber*>& subscribers = it->second->subscribers;
+	auto position = std::find(subscribers.begin(), subscribers.end(), subscriber);
+	if (position != subscribers.end())
+	{
+		*position = subscribers.back();
+		subscribers.pop_back();
+	}
+
+	// A publisher still holding the channel keeps it alive until it is done
+	if (subscribers.empty())
+		channels.erase(it);
+}
+
+size_t LiveHub::publish(const std::string& channel_name, std::string_view message, bool binary)
+{
+	std::shared_ptr<Channel> channel;
+	{
+		std::lock_guard<std::mutex> lock(channels_mutex);
+		auto it = channels.find(channel_name);
+		if (it == channels.end())
+			return 0;
+		channel = it->second;
+	}
+
+	// Encoded on first use, then shared by every subscriber speaking that protocol
+	std::shared_ptr<const std::string> websocket_frame;
+	std::shared_ptr<const std::string> event_stream;
+
+	size_t delivered = 0;
+	size_t skipped = 0;
+	std::lock_guard<std::mutex> channel_lock(channel->mutex);
+	for (LiveSubscriber* subscriber : channel->subscribers)
+	{
+		std::shared_ptr<const std::string>* encoded = &event_stream;
+		if (subscriber->protocol == LiveProtocol::WebSocket)
+			encoded = &websocket_frame;
+
+		if (!*encoded)
+		{
+			if (subscriber->protocol == LiveProtocol::WebSocket)
+				*encoded = std::make_shared<const std::string>(encodeWebSocketFrame(binary ? WS_BINARY : WS_TEXT, message));
+			else
+				*encoded = std::make_shared<const std::string>(encodeEventStream(message));
+		}
+
+		{
+			std::lock_guard<std::mutex> subscriber_lock(subscriber->mutex);
+			if (subscriber->closing)
+				continue;
+
+			if (subscriber->pending_bytes + (*encoded)->length() > max_pending_bytes)
+			{
+				skipped++;
+				if (policy == SlowConsumerPolicy::Drop)
+				{
+					subscriber->dropped++;
+					continue;
+				}
+
+				// Disconnect: the queued backlog is abandoned and the connection closes
+				subscriber->closing = true;
+				subscriber->pending.clear();
+				subscriber->pending_bytes = 0;
+			}
+			else
+			{
+				subscriber->pending.push_back(*encoded);
+				subscriber->pending_bytes += (*encoded)->length();
+				delivered++;
+			}
+		}
+
+		WSASetEvent(subscriber->wake_event);
+	}
+
+	if (skipped > 0)
+		std::cout << "[LIVE] " << channel_name << ": " << skipped << " slow subscriber(s) "
+			<< (policy == SlowConsumerPolicy::Drop ? "skipped" : "disconnected") << std::endl;
+
+	return delivered;
+}
+
+bool LiveHub::takePending(LiveSubscriber& subscriber, std::vector<std::shared_ptr<const std::string>>& taken)
+{
+	std::lock_guard<std::mutex> lock(subscriber.mutex);
+
+	// Reset under the lock: anything queued after this point signals the event again
+	WSAResetEvent(subscriber.wake_event);
+
+	taken.swap(subscriber.pending);
+	subscriber.pending.clear();
+	subscriber.pending_bytes = 0;
+	return !subscriber.closing;
+}
+
+void LiveHub::closeAll()
+{
+	std::lock_guard<std::mutex> lock(channels_mutex);
+	closed = true;
+
+	for (auto& entry : channels)
+	{
+		std::lock_guard<std::mutex> channel_lock(entry.second->mutex);
+		for (LiveSubscriber* subscriber : entry.second->subscribers)
+		{
+			{
+				std::lock_guard<std::mutex> subscriber_lock(subscriber->mutex);
+				subscriber->closing = true;
+			}
+			WSASetEvent(subscriber->wake_event);
+		}
+	}
+}
+
+std::string encodeEventStream(std::string_view message)
+{
+	std::string event;
+	event.reserve(message.length() + 16);
+
+	size_t line_start = 0;
+	while (true)
+	{
+		size_t line_end = message.find('\n', line_start);
+		std::string_view line = message.substr(line_start, line_end == std::string_view::npos ? std::string_view::npos : line_end - line_start);
+		if (!line.empty() && line.back() == '\r')
+			line.remove_suffix(1);
+
+		event += "data: ";
+		event.append(line.data(), line.length());
+		event += '\n';
+
+		if (line_end == std::string_view::npos)
+			break;
+		line_start = line_end + 1;
+	}
+
+	event += '\n';
+	return event;
+}
@@ -1,187 +1,304 @@
 #include <iostream>
 #include <string>
 #include <thread>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <memory>
+#include <mutex>
 #include "server.h"
 #include "request_parser.h"
 #include "response_builder.h"
 #include "file_handler.h"
+#include "virtual_hosts.h"
+#include "connection_handler.h"
+#include "config.h"
+#include "mime_types.h"
+#include "tls.h"
+#include "handoff.h"
+#include "live_hub.h"
+#include "tracing.h"
+#include "rate_limiter.h"
 
-// Global flag for graceful shutdown
-volatile bool server_running = true;
+// Global flag for graceful shutdown; the accept loop checks it at least every ACCEPT_POLL_MS
+std::atomic<bool> server_running(true);
 
-// Forward declaration
-void handleClient(SOCKET client_socket, FileHandler& file_handler);
+const long ACCEPT_POLL_MS = 500;
 
-// Simple signal handler for Ctrl+C
+// Signal handler for Ctrl+C / SIGTERM: only flips the flag, the accept loop does the rest
 void signalHandler(int signal)
 {
-	std::cout << "\n[MAIN] Shutting down server..." << std::endl;
+	(void)signal;
 	server_running = false;
 }
 
-// Client handler function - runs in separate thread for each client
-// This function processes one complete request-response cycle
-void handleClient(SOCKET client_socket, FileHandler& file_handler)
+int main(int argc, char* argv[])
 {
-	std::cout << "[HANDLER] Client thread started for socket: " << client_socket << std::endl;
+	// Parse command-line arguments for port
+	int port = 8080;  // Default port
+	std::string webroot = "webroot";  // Default webroot
 
-	try
-	{
-		// STEP 1: Read request from socket
-		std::cout << "[HANDLER] Reading request from client..." << std::endl;
-		std::string raw_request = receiveData(client_socket);
+	if (argc > 1)
+		port = std::stoi(argv[1]);
+	if (argc > 2)
+		webroot = argv[2];
 
-		if (raw_request.empty())
-		{
-			std::cout << "[HANDLER] Empty request received" << std::endl;
-			closeSocket(client_socket);
-			std::cout << "[HANDLER] Client thread terminating" << std::endl;
-			return;
-		}
+	// Optional config file as third argument
+	ServerConfig config;
+	if (argc > 3)
+		config = loadConfig(argv[3]);
 
-		// STEP 2: Parse the request
-		std::cout << "[HANDLER] Parsing HTTP request..." << std::endl;
-		RequestData request = parseRequest(raw_request);
+	std::cout << "=====================================" << std::endl;
+	std::cout << "   HTTP/1.1 Server (Multi-threaded)" << std::endl;
+	std::cout << "=====================================" << std::endl;
+	std::cout << "[MAIN] Port: " << port << std::endl;
+	std::cout << "[MAIN] Webroot: " << webroot << std::endl;
 
-		ResponseData response;
+	// Extra MIME mappings must be in place before the webroot is indexed
+	if (!config.mime_types_file.empty())
+		loadMimeTypes(config.mime_types_file);
+	freezeMimeTypes();
 
-		// STEP 3: Validate request
-		if (!request.is_valid)
-		{
-			std::cout << "[HANDLER] Invalid request: " << request.error_message << std::endl;
-			response = generateErrorResponse(400, "Bad Request: " + request.error_message);
-		}
-		// STEP 4: Handle the request (currently only GET)
-		else if (request.method == "GET")
-		{
-			std::cout << "[HANDLER] Handling GET request for: " << request.path << std::endl;
-			response = file_handler.handleGetRequest(request.path);
-		}
-		else
-		{
-			std::cout << "[HANDLER] Unsupported method: " << request.method << std::endl;
-			response = generateErrorResponse(405, "Method Not Allowed");
-		}
+	// One site per configured vhost; the command-line webroot serves any other host
+	// unless default_host picks one of the vhosts instead
+	std::vector<VirtualHostConfig> sites = config.virtual_hosts;
+	if (config.default_host.empty())
+		sites.push_back({"*", webroot, config.bundle_file});
+	VirtualHostTable hosts(sites, config.default_host);
 
-		// STEP 5: Serialize response
-		std::cout << "[HANDLER] Serializing response (status " << response.status_code << ")..." << std::endl;
-		std::string response_str = serializeResponse(response);
+	// Reverse proxy for configured path prefixes
+	BalancePolicy balance = config.proxy_balance == "round_robin" ? BalancePolicy::RoundRobin : BalancePolicy::LeastConnections;
+	UpstreamProxy proxy(config.proxy_routes, balance);
 
-		// STEP 6: Send response to client
-		std::cout << "[HANDLER] Sending response to client..." << std::endl;
-		int bytes_sent = sendData(client_socket, response_str);
-
-		if (bytes_sent > 0)
-		{
-			std::cout << "[HANDLER] Sent " << bytes_sent << " bytes to client" << std::endl;
-		}
-		else
+	// TLS termination when a certificate is configured
+	TlsContext* tls_context = nullptr;
+	if (!config.tls_cert_file.empty() || !config.tls_key_file.empty())
+	{
+		tls_context = createTlsContext(config.tls_cert_file, config.tls_key_file);
+		if (tls_context == nullptr)
 		{
-			std::cout << "[HANDLER] Failed to send response" << std::endl;
+			std::cout << "[ERROR] TLS is configured but could not be initialized" << std::endl;
+			return 1;
 		}
+	}
 
-		// STEP 7: Close connection
-		std::cout << "[HANDLER] Closing client connection..." << std::endl;
-		closeSocket(client_socket);
+	ServerContext context = {&hosts, proxy.empty() ? nullptr : &proxy, tls_context};
 
-		std::cout << "[HANDLER] Client thread terminating" << std::endl;
-	}
-	catch (const std::exception& e)
+	// WebSocket/SSE channels under a path prefix
+	std::unique_ptr<LiveHub> live;
+	if (!config.live_prefix.empty())
 	{
-		std::cout << "[HANDLER] Exception in client handler: " << e.what() << std::endl;
-		closeSocket(client_socket);
+		SlowConsumerPolicy slow_policy = config.live_slow_consumer == "drop" ? SlowConsumerPolicy::Drop : SlowConsumerPolicy::Disconnect;
+		live.reset(new LiveHub(config.live_prefix, config.live_queue_limit, slow_policy));
+		context.live = live.get();
 	}
-	catch (...)
+
+	// Per-client request and bandwidth limits
+	std::unique_ptr<RateLimiter> limiter;
+	if (config.rate_limit_requests > 0 || config.rate_limit_bytes > 0)
 	{
-		std::cout << "[HANDLER] Unknown exception in client handler" << std::endl;
-		closeSocket(client_socket);
+		RateLimitOptions limits;
+		limits.requests_per_second = config.rate_limit_requests;
+		limits.request_burst = config.rate_limit_burst;
+		limits.bytes_per_second = config.rate_limit_bytes;
+		limits.byte_burst = config.rate_limit_byte_burst;
+		limits.prefix_bits = config.rate_limit_prefix;
+		limits.table_size = config.rate_limit_clients;
+		limiter.reset(new RateLimiter(limits));
+		context.limiter = limiter.get();
 	}
-}
-
-int main(int argc, char* argv[])
-{
-	// Parse command-line arguments for port
-	int port = 8080;  // Default port
-	std::string webroot = "webroot";  // Default webroot
 
-	if (argc > 1)
-		port = std::stoi(argv[1]);
-	if (argc > 2)
-		webroot = argv[2];
+	configureBufferPool(config.buffer_thread_cache, config.buffer_global_cache);
+	configureTracing(config.trace_sample_rate, config.trace_max_events);
+	if (config.max_request_size != 0)
+		context.max_request_size = config.max_request_size;
+	context.uploads = config.uploads;
+	context.upload_max_size = config.upload_max_size;
+	if (context.uploads)
+		std::cout << "[MAIN] Accepting uploads" << (config.upload_max_size != 0 ? " up to " + std::to_string(config.upload_max_size) + " bytes" : "") << std::endl;
 
-	std::cout << "=====================================" << std::endl;
-	std::cout << "   HTTP/1.1 Server (Multi-threaded)" << std::endl;
-	std::cout << "=====================================" << std::endl;
-	std::cout << "[MAIN] Port: " << port << std::endl;
-	std::cout << "[MAIN] Webroot: " << webroot << std::endl;
+	std::signal(SIGINT, signalHandler);
+	std::signal(SIGTERM, signalHandler);
 
-	// Initialize file handler
-	FileHandler file_handler(webroot);
+	ListenerOptions listener_options;
+	if (config.listen_backlog > 0)
+		listener_options.backlog = config.listen_backlog;
+	listener_options.no_delay = config.tcp_nodelay;
+	listener_options.fast_open_queue = config.tcp_fastopen;
+	listener_options.defer_accept_s = config.defer_accept;
+	listener_options.receive_buffer = config.socket_rcvbuf;
+	listener_options.send_buffer = config.socket_sndbuf;
 
-	// STEP 1: Create server socket
-	std::cout << "\n[MAIN] Creating server socket..." << std::endl;
-	SocketServer server = createServerSocket(port);
+	// STEP 1: Take over the listening socket of a running server, or create our own
+	// (a handed-over socket keeps the options the previous process set on it)
+	SocketServer server = {INVALID_SOCKET, port, listener_options};
+	if (config.handoff_port != 0)
+		server.listening_socket = receiveListeningSocket(config.handoff_port, config.handoff_secret);
 
 	if (server.listening_socket == INVALID_SOCKET)
 	{
-		std::cout << "[ERROR] Failed to create socket" << std::endl;
-		return 1;
+		std::cout << "\n[MAIN] Creating server socket..." << std::endl;
+		server = createServerSocket(port, listener_options);
+
+		if (server.listening_socket == INVALID_SOCKET)
+		{
+			std::cout << "[ERROR] Failed to create socket" << std::endl;
+			return 1;
+		}
+
+		// STEP 2: Bind socket to port
+		std::cout << "[MAIN] Binding socket to port " << port << "..." << std::endl;
+		bindSocket(server);
+
+		// STEP 3: Listen for connections
+		std::cout << "[MAIN] Listening for connections..." << std::endl;
+		listenSocket(server);
 	}
 
-	// STEP 2: Bind socket to port
-	std::cout << "[MAIN] Binding socket to port " << port << "..." << std::endl;
-	bindSocket(server);
+	// Non-blocking, so each wakeup can drain the accept queue and stop at WSAEWOULDBLOCK
+	setNonBlocking(server.listening_socket, true);
 
-	// STEP 3: Listen for connections
-	std::cout << "[MAIN] Listening for connections..." << std::endl;
-	listenSocket(server);
+	// Control port for the next process to take the listening socket over
+	SOCKET control_listener = INVALID_SOCKET;
+	if (config.handoff_port != 0)
+		control_listener = openHandoffListener(config.handoff_port);
 
 	std::cout << "\n[SUCCESS] Server started successfully!" << std::endl;
-	std::cout << "Connect to: http://localhost:" << port << "/" << std::endl;
+	std::cout << "Connect to: " << (tls_context != nullptr ? "https" : "http") << "://localhost:" << port << "/" << std::endl;
 	std::cout << "[INFO] Press Ctrl+C to shut down" << std::endl;
 	std::cout << "=====================================" << std::endl << std::endl;
 
+	// A handoff runs on its own thread: a control connection that stalls (each step may take
+	// up to HANDOFF_TIMEOUT_MS) must not hold up accepts. One runs at a time.
+	std::thread handoff_thread;
+	std::atomic<bool> handoff_running(false);
+	std::atomic<bool> handed_off(false);
+
 	// STEP 4: Main server loop - Accept clients and create threads
 	int client_count = 0;
-	while (server_running)
+	while (server_running && !handed_off)
 	{
-		// STEP 4a: Accept incoming client connection
-		std::cout << "[MAIN] Waiting for client connection..." << std::endl;
-		SOCKET client_socket = acceptConnection(server);
+		// STEP 4a: Wait for a client or a handoff request, waking up to check server_running
+		fd_set readable;
+		FD_ZERO(&readable);
+		FD_SET(server.listening_socket, &readable);
+		bool watch_control = control_listener != INVALID_SOCKET && !handoff_running;
+		if (watch_control)
+			FD_SET(control_listener, &readable);
 
-		if (client_socket == INVALID_SOCKET)
+		timeval timeout = {0, ACCEPT_POLL_MS * 1000};
+		int ready = select(0, &readable, nullptr, nullptr, &timeout);
+		if (ready == SOCKET_ERROR)
 		{
-			std::cout << "[ERROR] Failed to accept connection" << std::endl;
+			if (WSAGetLastError() != WSAEINTR)
+				std::cout << "[ERROR] select failed: " << WSAGetLastError() << std::endl;
 			continue;
 		}
 
-		client_count++;
-		std::cout << "[MAIN] Client #" << client_count << " connected" << std::endl;
-
-		// STEP 4b: Create new thread for this client
-		// The thread runs handleClient() independently
-		// Main loop immediately returns to accept() waiting for next client
-		try
+		if (watch_control && FD_ISSET(control_listener, &readable))
 		{
-			std::thread client_thread(handleClient, client_socket, std::ref(file_handler));
-			client_thread.detach();  // Let thread run independently, no need to join
-			std::cout << "[MAIN] Created thread for client #" << client_count << std::endl;
+			if (handoff_thread.joinable())
+				handoff_thread.join();
+
+			// Once a new process shares the listening socket, this loop stops accepting and drains
+			auto handoff = [&]() {
+				if (serveHandoff(control_listener, server.listening_socket, config.handoff_secret))
+					handed_off = true;
+				handoff_running = false;
+			};
+			handoff_running = true;
+			try
+			{
+				handoff_thread = std::thread(handoff);
+			}
+			catch (const std::exception& e)
+			{
+				std::cout << "[ERROR] Failed to create handoff thread: " << e.what() << std::endl;
+				handoff();
+			}
 		}
-		catch (const std::exception& e)
+
+		if (!FD_ISSET(server.listening_socket, &readable))
+			continue;
+
+		// STEP 4b: Accept every queued client, up to accept_batch per wakeup
+		for (int accepted = 0; accepted < config.accept_batch; accepted++)
 		{
-			std::cout << "[ERROR] Failed to create thread: " << e.what() << std::endl;
-			closeSocket(client_socket);
+			sockaddr_in peer;
+			SOCKET client_socket = acceptConnection(server, peer);
+
+			if (client_socket == INVALID_SOCKET)
+				break;
+
+			client_count++;
+			std::cout << "[MAIN] Client #" << client_count << " connected from " << formatAddress(peer) << ", socket: " << client_socket << std::endl;
+
+			// STEP 4c: Create new thread for this client
+			// The thread runs handleClient() independently
+			// Main loop immediately returns to accept() for the next queued client
+			// Counted before the thread exists, so a drain starting now already waits for it
+			registerClient(context, client_socket);
+			try
+			{
+				std::thread client_thread(handleClient, client_socket, peer, std::ref(context));
+				client_thread.detach();  // The drain below waits on the count instead of joining
+			}
+			catch (const std::exception& e)
+			{
+				std::cout << "[ERROR] Failed to create thread: " << e.what() << std::endl;
+				{
+					std::lock_guard<std::mutex> lock(context.sockets_mutex);
+					context.client_sockets.erase(client_socket);
+				}
+				context.active_connections--;
+				closeSocket(client_socket);
+			}
 		}
 	}
 
-	// STEP 5: Shutdown - Close listening socket
-	std::cout << "\n[MAIN] Closing listening socket..." << std::endl;
+	// STEP 5: Shutdown - Close listening socket (after a handoff the new process keeps its own copy)
+	std::cout << "\n[MAIN] Shutting down server..." << std::endl;
+	if (handoff_thread.joinable())
+		handoff_thread.join();  // It still uses both sockets; bounded by its control timeouts
+	std::cout << "[MAIN] Closing listening socket..." << std::endl;
+	closeSocket(control_listener);
 	closeSocket(server.listening_socket);
 
+	// STEP 5b: Drain - let in-flight requests finish; idle keep-alive connections close after their current request
+	context.draining = true;
+	if (live)
+		live->closeAll();
+	auto drain_deadline = std::chrono::steady_clock::now() + std::chrono::seconds(config.drain_timeout);
+	while (context.active_connections > 0 && std::chrono::steady_clock::now() < drain_deadline)
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+	// Past the deadline: shut down the stragglers' sockets and wait for their threads, which still use
+	// context, hosts, proxy and tracing (an upstream exchange ends within UPSTREAM_TIMEOUT_MS)
+	if (context.active_connections > 0)
+	{
+		std::cout << "[MAIN] Drain deadline passed with " << context.active_connections << " connection(s) still open, closing them" << std::endl;
+		abortClients(context);
+		while (context.active_connections > 0)
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	}
+	std::cout << "[MAIN] All connections drained" << std::endl;
+
+	if (config.trace_sample_rate != 0)
+		writeChromeTrace(config.trace_file);
+
+	destroyTlsContext(tls_context);
+
 	// STEP 6: Cleanup Winsock
 	std::cout << "[MAIN] Cleaning up Winsock..." << std::endl;
 	WSACleanup();
 
+	for (const auto& host : hosts.hosts())
+	{
+		std::cout << "[VHOST] " << host->name << ": " << host->metrics.requests << " requests, "
+			<< host->metrics.client_errors << " 4xx, " << host->metrics.server_errors << " 5xx, "
+			<< host->metrics.body_bytes << " body bytes" << std::endl;
+	}
+
 	std::cout << "[SUCCESS] Server shut down gracefully" << std::endl;
 	std::cout << "[INFO] Handled " << client_count << " client connections" << std::endl;
 	return 0;
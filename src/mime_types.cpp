@@ -0,0 +1,691 @@
+#include "mime_types.h"
+#include <array>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+// Built-in extension -> MIME type mappings (extensions lowercase, without the dot)
+struct MimeMapping {
+	std::string_view extension;
+	std::string_view mime_type;
+};
+
+constexpr MimeMapping MIME_MAPPINGS[] = {
+	{"726", "audio/32kadpcm"},
+	{"7z", "application/x-7z-compressed"},
+	{"aa3", "audio/ATRAC3"},
+	{"aac", "audio/aac"},
+	{"aal", "audio/ATRAC-ADVANCED-LOSSLESS"},
+	{"ac", "application/pkix-attr-cert"},
+	{"ac3", "audio/ac3"},
+	{"acn", "audio/asc"},
+	{"adts", "audio/aac"},
+	{"ai", "application/postscript"},
+	{"aif", "audio/x-aiff"},
+	{"aiff", "audio/x-aiff"},
+	{"amlx", "application/automationml-amlx+zip"},
+	{"amr", "audio/AMR"},
+	{"apk", "application/vnd.android.package-archive"},
+	{"apng", "image/apng"},
+	{"appcache", "text/cache-manifest"},
+	{"asc", "application/pgp-keys"},
+	{"ass", "audio/aac"},
+	{"at3", "audio/ATRAC3"},
+	{"atom", "application/atom+xml"},
+	{"atomcat", "application/atomcat+xml"},
+	{"atomdeleted", "application/atomdeleted+xml"},
+	{"atomsrv", "application/atomserv+xml"},
+	{"atomsvc", "application/atomsvc+xml"},
+	{"atx", "audio/ATRAC-X"},
+	{"au", "audio/basic"},
+	{"auc", "application/tamp-apex-update-confirm"},
+	{"avci", "image/avci"},
+	{"avcs", "image/avcs"},
+	{"avi", "video/x-msvideo"},
+	{"avif", "image/avif"},
+	{"awb", "audio/AMR-WB"},
+	{"axa", "audio/annodex"},
+	{"axv", "video/annodex"},
+	{"bat", "application/x-msdos-program"},
+	{"bib", "text/x-bibtex"},
+	{"bin", "application/octet-stream"},
+	{"bmp", "image/bmp"},
+	{"brf", "text/plain"},
+	{"btf", "image/prs.btif"},
+	{"btif", "image/prs.btif"},
+	{"c", "text/x-csrc"},
+	{"c++", "text/x-c++src"},
+	{"cbr", "application/vnd.comicbook-rar"},
+	{"cc", "text/x-c++src"},
+	{"cer", "application/pkix-cert"},
+	{"cgm", "image/cgm"},
+	{"class", "application/java-vm"},
+	{"cls", "text/x-tex"},
+	{"cnd", "text/jcr-cnd"},
+	{"com", "application/x-msdos-program"},
+	{"cpio", "application/x-cpio"},
+	{"cpp", "text/x-c++src"},
+	{"cql", "text/cql"},
+	{"crl", "application/pkix-crl"},
+	{"crt", "application/x-x509-ca-cert"},
+	{"csd", "audio/csound"},
+	{"csh", "application/x-csh"},
+	{"css", "text/css"},
+	{"csv", "text/csv"},
+	{"csvs", "text/csv-schema"},
+	{"cxx", "text/x-c++src"},
+	{"d", "text/x-dsrc"},
+	{"deploy", "application/octet-stream"},
+	{"dif", "video/dv"},
+	{"diff", "text/x-diff"},
+	{"djv", "image/vnd.djvu"},
+	{"djvu", "image/vnd.djvu"},
+	{"dll", "application/x-msdos-program"},
+	{"dls", "audio/dls"},
+	{"dmg", "application/x-apple-diskimage"},
+	{"doc", "application/msword"},
+	{"docx", "application/vnd.openxmlformats-officedocument.wordprocessingml.document"},
+	{"dotx", "application/vnd.openxmlformats-officedocument.wordprocessingml.template"},
+	{"dpx", "image/dpx"},
+	{"drle", "image/dicom-rle"},
+	{"dsc", "text/prs.lines.tag"},
+	{"dtd", "application/xml-dtd"},
+	{"dv", "video/dv"},
+	{"dvi", "application/x-dvi"},
+	{"dwg", "image/vnd.dwg"},
+	{"dxf", "image/vnd.dxf"},
+	{"emf", "image/emf"},
+	{"ent", "application/xml-external-parsed-entity"},
+	{"enw", "audio/EVRCNW"},
+	{"eot", "application/vnd.ms-fontobject"},
+	{"eps", "application/postscript"},
+	{"eps2", "application/postscript"},
+	{"eps3", "application/postscript"},
+	{"epsf", "application/postscript"},
+	{"epsi", "application/postscript"},
+	{"epub", "application/epub+zip"},
+	{"es", "text/javascript"},
+	{"etx", "text/x-setext"},
+	{"evb", "audio/EVRCB"},
+	{"evc", "audio/EVRC"},
+	{"evw", "audio/EVRCWB"},
+	{"exe", "application/x-msdos-program"},
+	{"exr", "image/aces"},
+	{"fit", "image/fits"},
+	{"fits", "image/fits"},
+	{"flac", "audio/flac"},
+	{"fli", "video/fli"},
+	{"flv", "video/x-flv"},
+	{"fts", "image/fits"},
+	{"gcd", "text/x-pcs-gcd"},
+	{"geojson", "application/geo+json"},
+	{"gf", "application/x-tex-gf"},
+	{"gff3", "text/gff3"},
+	{"gif", "image/gif"},
+	{"gl", "video/gl"},
+	{"glbin", "application/gltf-buffer"},
+	{"glbuf", "application/gltf-buffer"},
+	{"gpkg", "application/geopackage+sqlite3"},
+	{"gram", "application/srgs"},
+	{"grxml", "application/srgs+xml"},
+	{"gsf", "application/x-font"},
+	{"gtar", "application/x-gtar"},
+	{"gz", "application/gzip"},
+	{"h", "text/x-chdr"},
+	{"h++", "text/x-c++hdr"},
+	{"heic", "image/heic"},
+	{"heics", "image/heic-sequence"},
+	{"heif", "image/heif"},
+	{"heifs", "image/heif-sequence"},
+	{"hej2", "image/hej2k"},
+	{"hh", "text/x-c++hdr"},
+	{"hif", "image/avif"},
+	{"hpp", "text/x-c++hdr"},
+	{"hpub", "application/prs.hpub+zip"},
+	{"hqx", "application/mac-binhex40"},
+	{"hs", "text/x-haskell"},
+	{"hsj2", "image/hsj2"},
+	{"hta", "application/hta"},
+	{"htc", "text/x-component"},
+	{"htm", "text/html"},
+	{"html", "text/html"},
+	{"hxx", "text/x-c++hdr"},
+	{"ico", "image/x-icon"},
+	{"ics", "text/calendar"},
+	{"ief", "image/ief"},
+	{"ifb", "text/calendar"},
+	{"iso", "application/x-iso9660-image"},
+	{"jar", "application/java-archive"},
+	{"java", "text/x-java"},
+	{"jfif", "image/jpeg"},
+	{"jhc", "image/jphc"},
+	{"jls", "image/jls"},
+	{"jng", "image/x-jng"},
+	{"jnlp", "application/x-java-jnlp-file"},
+	{"jp2", "image/jp2"},
+	{"jpe", "image/jpeg"},
+	{"jpeg", "image/jpeg"},
+	{"jpf", "image/jpx"},
+	{"jpg", "image/jpeg"},
+	{"jpg2", "image/jp2"},
+	{"jpgm", "image/jpm"},
+	{"jph", "image/jph"},
+	{"jphc", "image/jphc"},
+	{"jpm", "image/jpm"},
+	{"jpx", "image/jpx"},
+	{"jrd", "application/jrd+json"},
+	{"js", "application/javascript"},
+	{"json", "application/json"},
+	{"json-patch", "application/json-patch+json"},
+	{"jsonld", "application/ld+json"},
+	{"jsontd", "application/td+json"},
+	{"jsontm", "application/tm+json"},
+	{"jxl", "image/jxl"},
+	{"jxr", "image/jxr"},
+	{"jxra", "image/jxrA"},
+	{"jxrs", "image/jxrS"},
+	{"jxs", "image/jxs"},
+	{"jxsc", "image/jxsc"},
+	{"jxsi", "image/jxsi"},
+	{"jxss", "image/jxss"},
+	{"key", "application/pgp-keys"},
+	{"kml", "application/vnd.google-earth.kml+xml"},
+	{"ktx", "image/ktx"},
+	{"ktx2", "image/ktx2"},
+	{"l16", "audio/L16"},
+	{"latex", "application/x-latex"},
+	{"lbc", "audio/iLBC"},
+	{"lhs", "text/x-literate-haskell"},
+	{"loas", "audio/usac"},
+	{"lpf", "application/lpf+zip"},
+	{"ltx", "text/x-tex"},
+	{"lzh", "application/x-lzh"},
+	{"m1v", "video/mpeg"},
+	{"m2v", "video/mpeg"},
+	{"m3u", "audio/mpegurl"},
+	{"m3u8", "application/vnd.apple.mpegurl"},
+	{"m4a", "audio/mp4"},
+	{"m4s", "video/iso.segment"},
+	{"m4v", "video/mp4"},
+	{"manifest", "text/cache-manifest"},
+	{"map", "application/json"},
+	{"markdown", "text/markdown"},
+	{"mbox", "application/mbox"},
+	{"md", "text/markdown"},
+	{"mft", "application/rpki-manifest"},
+	{"mhas", "audio/mhas"},
+	{"mid", "audio/sp-midi"},
+	{"miz", "text/mizar"},
+	{"mj2", "video/mj2"},
+	{"mjp2", "video/mj2"},
+	{"mjs", "application/javascript"},
+	{"mkv", "video/x-matroska"},
+	{"mml", "application/mathml+xml"},
+	{"mng", "video/x-mng"},
+	{"moc", "text/x-moc"},
+	{"mod", "application/xml-dtd"},
+	{"mods", "application/mods+xml"},
+	{"mov", "video/quicktime"},
+	{"mp1", "audio/mpeg"},
+	{"mp2", "audio/mpeg"},
+	{"mp3", "audio/mpeg"},
+	{"mp4", "video/mp4"},
+	{"mpd", "application/dash+xml"},
+	{"mpdd", "application/dashdelta"},
+	{"mpe", "video/mpeg"},
+	{"mpeg", "video/mpeg"},
+	{"mpega", "audio/mpeg"},
+	{"mpg", "video/mpeg"},
+	{"mpg4", "video/mp4"},
+	{"mpga", "audio/mpeg"},
+	{"mrc", "application/marc"},
+	{"mrcx", "application/marcxml+xml"},
+	{"msi", "application/x-msi"},
+	{"msp", "application/octet-stream"},
+	{"msu", "application/octet-stream"},
+	{"mxmf", "audio/mobile-xmf"},
+	{"n3", "text/n3"},
+	{"nq", "application/n-quads"},
+	{"nt", "application/n-triples"},
+	{"odm", "application/vnd.oasis.opendocument.text-master"},
+	{"odp", "application/vnd.oasis.opendocument.presentation"},
+	{"ods", "application/vnd.oasis.opendocument.spreadsheet"},
+	{"odt", "application/vnd.oasis.opendocument.text"},
+	{"oga", "audio/ogg"},
+	{"ogg", "audio/ogg"},
+	{"ogv", "video/ogg"},
+	{"ogx", "application/ogg"},
+	{"omg", "audio/ATRAC3"},
+	{"opus", "audio/ogg"},
+	{"orc", "audio/csound"},
+	{"otf", "font/otf"},
+	{"oth", "application/vnd.oasis.opendocument.text-web"},
+	{"otp", "application/vnd.oasis.opendocument.presentation-template"},
+	{"ots", "application/vnd.oasis.opendocument.spreadsheet-template"},
+	{"ott", "application/vnd.oasis.opendocument.text-template"},
+	{"p", "text/x-pascal"},
+	{"p10", "application/pkcs10"},
+	{"p12", "application/pkcs12"},
+	{"p7c", "application/pkcs7-mime"},
+	{"p7m", "application/pkcs7-mime"},
+	{"p7r", "application/x-pkcs7-certreqresp"},
+	{"p7s", "application/pkcs7-signature"},
+	{"p7z", "application/pkcs7-mime"},
+	{"p8", "application/pkcs8"},
+	{"p8e", "application/pkcs8-encrypted"},
+	{"pas", "text/x-pascal"},
+	{"patch", "text/x-diff"},
+	{"pbm", "image/x-portable-bitmap"},
+	{"pcf", "application/x-font-pcf"},
+	{"pdf", "application/pdf"},
+	{"pfa", "application/x-font"},
+	{"pfb", "application/x-font"},
+	{"pfr", "application/font-tdpfr"},
+	{"pfx", "application/pkcs12"},
+	{"pgm", "image/x-portable-graymap"},
+	{"pgp", "application/pgp-encrypted"},
+	{"pk", "application/x-tex-pk"},
+	{"pkipath", "application/pkix-pkipath"},
+	{"pl", "text/x-perl"},
+	{"pls", "audio/x-scpls"},
+	{"pm", "text/x-perl"},
+	{"png", "image/png"},
+	{"pnm", "image/x-portable-anymap"},
+	{"pot", "text/plain"},
+	{"potm", "application/vnd.ms-powerpoint.template.macroEnabled.12"},
+	{"potx", "application/vnd.openxmlformats-officedocument.presentationml.template"},
+	{"ppam", "application/vnd.ms-powerpoint.addin.macroEnabled.12"},
+	{"ppm", "image/x-portable-pixmap"},
+	{"pps", "application/vnd.ms-powerpoint"},
+	{"ppsm", "application/vnd.ms-powerpoint.slideshow.macroEnabled.12"},
+	{"ppsx", "application/vnd.openxmlformats-officedocument.presentationml.slideshow"},
+	{"ppt", "application/vnd.ms-powerpoint"},
+	{"pptm", "application/vnd.ms-powerpoint.presentation.macroEnabled.12"},
+	{"pptx", "application/vnd.openxmlformats-officedocument.presentationml.presentation"},
+	{"provn", "text/provenance-notation"},
+	{"ps", "application/postscript"},
+	{"psd", "image/vnd.adobe.photoshop"},
+	{"psid", "audio/prs.sid"},
+	{"pti", "image/prs.pti"},
+	{"py", "text/x-python"},
+	{"pyc", "application/x-python-code"},
+	{"pyo", "application/x-python-code"},
+	{"qcp", "audio/EVRC-QCP"},
+	{"qt", "video/quicktime"},
+	{"ra", "audio/x-pn-realaudio"},
+	{"ram", "audio/x-pn-realaudio"},
+	{"rar", "application/vnd.rar"},
+	{"rb", "application/x-ruby"},
+	{"rdf", "application/rdf+xml"},
+	{"rdf-crypt", "application/prs.rdf-xml-crypt"},
+	{"rgb", "image/x-rgb"},
+	{"rnc", "application/relax-ng-compact-syntax"},
+	{"roff", "text/troff"},
+	{"rpm", "application/x-redhat-package-manager"},
+	{"rq", "application/sparql-query"},
+	{"rss", "application/rss+xml"},
+	{"rst", "text/prs.fallenstein.rst"},
+	{"rtf", "application/rtf"},
+	{"sarif", "application/sarif+json"},
+	{"scala", "text/x-scala"},
+	{"scim", "application/scim+json"},
+	{"sco", "audio/csound"},
+	{"senml", "application/senml+json"},
+	{"senml-etchj", "application/senml-etch+json"},
+	{"sensml", "application/sensml+json"},
+	{"ser", "application/java-serialized-object"},
+	{"sgm", "text/SGML"},
+	{"sgml", "text/SGML"},
+	{"sh", "application/x-sh"},
+	{"shaclc", "text/shaclc"},
+	{"shar", "application/x-shar"},
+	{"shc", "text/shaclc"},
+	{"shex", "text/shex"},
+	{"shtml", "text/html"},
+	{"sid", "audio/prs.sid"},
+	{"sig", "application/pgp-signature"},
+	{"sldm", "application/vnd.ms-powerpoint.slide.macroEnabled.12"},
+	{"sldx", "application/vnd.openxmlformats-officedocument.presentationml.slide"},
+	{"smi", "application/smil+xml"},
+	{"smil", "application/smil+xml"},
+	{"sml", "application/smil+xml"},
+	{"smv", "audio/SMV"},
+	{"snd", "audio/basic"},
+	{"soa", "text/dns"},
+	{"sofa", "audio/sofa"},
+	{"spdx", "text/spdx"},
+	{"spx", "audio/ogg"},
+	{"sql", "application/sql"},
+	{"sqlite", "application/vnd.sqlite3"},
+	{"sqlite3", "application/vnd.sqlite3"},
+	{"srt", "text/plain"},
+	{"srx", "application/sparql-results+xml"},
+	{"ssml", "application/ssml+xml"},
+	{"stix", "application/stix+json"},
+	{"sty", "text/x-tex"},
+	{"svg", "image/svg+xml"},
+	{"svgz", "image/svg+xml"},
+	{"t", "text/troff"},
+	{"tag", "text/prs.lines.tag"},
+	{"tar", "application/x-tar"},
+	{"tau", "application/tamp-apex-update"},
+	{"taz", "application/x-gtar-compressed"},
+	{"tex", "text/x-tex"},
+	{"texi", "application/x-texinfo"},
+	{"texinfo", "application/x-texinfo"},
+	{"text", "text/plain"},
+	{"tfx", "image/tiff-fx"},
+	{"tgz", "application/x-gtar-compressed"},
+	{"tif", "image/tiff"},
+	{"tiff", "image/tiff"},
+	{"tk", "text/x-tcl"},
+	{"tm", "text/texmacs"},
+	{"toml", "application/toml"},
+	{"torrent", "application/x-bittorrent"},
+	{"tr", "text/troff"},
+	{"trig", "application/trig"},
+	{"ts", "video/mp2t"},
+	{"tsv", "text/tab-separated-values"},
+	{"ttc", "font/collection"},
+	{"ttf", "font/ttf"},
+	{"ttl", "text/turtle"},
+	{"txt", "text/plain"},
+	{"uri", "text/uri-list"},
+	{"uris", "text/uri-list"},
+	{"vcard", "text/vcard"},
+	{"vcf", "text/vcard"},
+	{"vcj", "application/voucher-cms+json"},
+	{"vcs", "text/x-vcalendar"},
+	{"vtt", "text/vtt"},
+	{"wasm", "application/wasm"},
+	{"wav", "audio/wav"},
+	{"wbmp", "image/vnd.wap.wbmp"},
+	{"webm", "video/webm"},
+	{"webmanifest", "application/manifest+json"},
+	{"webp", "image/webp"},
+	{"wgsl", "text/wgsl"},
+	{"wma", "audio/x-ms-wma"},
+	{"wmf", "image/wmf"},
+	{"wmv", "video/x-ms-wmv"},
+	{"woff", "font/woff"},
+	{"woff2", "font/woff2"},
+	{"wsdl", "application/wsdl+xml"},
+	{"xbm", "image/x-xbitmap"},
+	{"xdd", "application/bacnet-xdd+zip"},
+	{"xhe", "audio/usac"},
+	{"xht", "application/xhtml+xml"},
+	{"xhtm", "application/xhtml+xml"},
+	{"xhtml", "application/xhtml+xml"},
+	{"xla", "application/vnd.ms-excel"},
+	{"xlam", "application/vnd.ms-excel.addin.macroEnabled.12"},
+	{"xlc", "application/vnd.ms-excel"},
+	{"xlm", "application/vnd.ms-excel"},
+	{"xls", "application/vnd.ms-excel"},
+	{"xlsb", "application/vnd.ms-excel.sheet.binary.macroEnabled.12"},
+	{"xlsm", "application/vnd.ms-excel.sheet.macroEnabled.12"},
+	{"xlsx", "application/vnd.openxmlformats-officedocument.spreadsheetml.sheet"},
+	{"xlt", "application/vnd.ms-excel"},
+	{"xltm", "application/vnd.ms-excel.template.macroEnabled.12"},
+	{"xltx", "application/vnd.openxmlformats-officedocument.spreadsheetml.template"},
+	{"xlw", "application/vnd.ms-excel"},
+	{"xml", "application/xml"},
+	{"xop", "application/xop+xml"},
+	{"xpm", "image/x-xpixmap"},
+	{"xsl", "application/xslt+xml"},
+	{"xslt", "application/xslt+xml"},
+	{"xspf", "application/xspf+xml"},
+	{"xul", "application/vnd.mozilla.xul+xml"},
+	{"xz", "application/x-xz"},
+	{"yaml", "application/yaml"},
+	{"yml", "application/yaml"},
+	{"zip", "application/zip"},
+	{"zone", "text/dns"},
+	{"zst", "application/zstd"},
+};
+
+constexpr size_t MIME_COUNT = sizeof(MIME_MAPPINGS) / sizeof(MIME_MAPPINGS[0]);
+constexpr size_t MAX_EXTENSION_LENGTH = 16;  // Longer extensions cannot match and are not hashed
+constexpr size_t BUCKET_COUNT = 256;         // First-level buckets, each with its own seed
+constexpr size_t SLOT_COUNT = 1024;          // Second-level slots (power of two, < 50% full)
+
+static_assert(MIME_COUNT < SLOT_COUNT / 2, "MIME table needs more slots");
+
+constexpr char asciiLower(char c)
+{
+	return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// FNV-1a over the lowercased key, mixed with a seed
+constexpr uint32_t mimeHash(std::string_view key, uint32_t seed)
+{
+	uint32_t hash = 2166136261u ^ (seed * 0x9E3779B9u);
+	for (char c : key)
+	{
+		hash ^= static_cast<unsigned char>(asciiLower(c));
+		hash *= 16777619u;
+	}
+	hash ^= hash >> 15;
+	return hash;
+}
+
+// Hash-and-displace perfect hash: every key's bucket stores a seed that sends all keys
+// of that bucket to distinct free slots, so a lookup is two hashes and one compare.
+struct MimeHashTable {
+	std::array<uint16_t, BUCKET_COUNT> seeds{};
+	std::array<uint16_t, SLOT_COUNT> slots{};  // Index into MIME_MAPPINGS plus one, 0 = empty
+};
+
+constexpr MimeHashTable buildMimeHashTable()
+{
+	MimeHashTable table;
+
+	std::array<uint16_t, MIME_COUNT> bucket_of{};
+	std::array<uint16_t, BUCKET_COUNT> bucket_size{};
+	size_t largest_bucket = 0;
+	for (size_t i = 0; i < MIME_COUNT; i++)
+	{
+		if (MIME_MAPPINGS[i].extension.length() > MAX_EXTENSION_LENGTH)
+			throw "MIME extension longer than MAX_EXTENSION_LENGTH";
+		bucket_of[i] = static_cast<uint16_t>(mimeHash(MIME_MAPPINGS[i].extension, 0) % BUCKET_COUNT);
+		bucket_size[bucket_of[i]]++;
+		largest_bucket = std::max<size_t>(largest_bucket, bucket_size[bucket_of[i]]);
+	}
+
+	// Place the most crowded buckets first while the table is still empty
+	for (size_t size = largest_bucket; size > 0; size--)
+	{
+		for (size_t bucket = 0; bucket < BUCKET_COUNT; bucket++)
+		{
+			if (bucket_size[bucket] != size)
+				continue;
+			if (size > 16)
+				throw "MIME bucket too large, raise BUCKET_COUNT";
+
+			std::array<uint16_t, 16> members{};
+			size_t member_count = 0;
+			for (size_t i = 0; i < MIME_COUNT; i++)
+			{
+				if (bucket_of[i] == bucket)
+					members[member_count++] = static_cast<uint16_t>(i);
+			}
+
+			bool placed = false;
+			for (uint32_t seed = 1; seed < 65536 && !placed; seed++)
+			{
+				std::array<uint16_t, 16> chosen{};
+				placed = true;
+				for (size_t m = 0; m < member_count && placed; m++)
+				{
+					uint16_t slot = static_cast<uint16_t>(mimeHash(MIME_MAPPINGS[members[m]].extension, seed) & (SLOT_COUNT - 1));
+					if (table.slots[slot] != 0)
+						placed = false;
+					for (size_t earlier = 0; earlier < m; earlier++)
+					{
+						if (chosen[earlier] == slot)
+							placed = false;
+					}
+					chosen[m] = slot;
+				}
+
+				if (placed)
+				{
+					table.seeds[bucket] = static_cast<uint16_t>(seed);
+					for (size_t m = 0; m < member_count; m++)
+						table.slots[chosen[m]] = static_cast<uint16_t>(members[m] + 1);
+				}
+			}
+
+			if (!placed)
+				throw "No perfect hash seed found (duplicate extension?)";
+		}
+	}
+
+	return table;
+}
+
+// Built entirely at compile time; a failure to build is a compile error
+constexpr MimeHashTable MIME_HASH_TABLE = buildMimeHashTable();
+
+// Case-insensitive equality against an already lowercase key
+static bool equalsLowercase(std::string_view lower_key, std::string_view value)
+{
+	if (lower_key.length() != value.length())
+		return false;
+
+	for (size_t i = 0; i < value.length(); i++)
+	{
+		if (lower_key[i] != asciiLower(value[i]))
+			return false;
+	}
+
+	return true;
+}
+
+// Case-insensitive ordering against an already lowercase key
+static bool lessThanLowercase(std::string_view lower_key, std::string_view value)
+{
+	size_t common = std::min(lower_key.length(), value.length());
+	for (size_t i = 0; i < common; i++)
+	{
+		char c = asciiLower(value[i]);
+		if (lower_key[i] != c)
+			return lower_key[i] < c;
+	}
+
+	return lower_key.length() < value.length();
+}
+
+// Extra mappings loaded at startup, sorted by extension; read-only once frozen
+static std::vector<std::pair<std::string, std::string>> extra_mime_types;
+static std::atomic<bool> extra_mime_types_frozen(false);
+
+// Look up the MIME type for a filename or path by its extension
+std::string_view lookupMimeType(std::string_view filename)
+{
+	// Scan back to the last dot; hitting a separator first means no extension
+	// (a dot in a directory name does not count)
+	size_t dot_pos = filename.length();
+	while (dot_pos > 0)
+	{
+		char c = filename[dot_pos - 1];
+		if (c == '.' || c == '/' || c == '\\')
+			break;
+		dot_pos--;
+	}
+
+	if (dot_pos == 0 || filename[dot_pos - 1] != '.')
+		return DEFAULT_MIME_TYPE;
+
+	std::string_view extension = filename.substr(dot_pos);
+
+	// Startup overrides win over the built-in table
+	if (extra_mime_types_frozen.load(std::memory_order_acquire) && !extra_mime_types.empty())
+	{
+		auto it = std::lower_bound(extra_mime_types.begin(), extra_mime_types.end(), extension,
+			[](const std::pair<std::string, std::string>& mapping, std::string_view ext)
+			{
+				return lessThanLowercase(mapping.first, ext);
+			});
+		if (it != extra_mime_types.end() && equalsLowercase(it->first, extension))
+			return it->second;
+	}
+
+	if (extension.empty() || extension.length() > MAX_EXTENSION_LENGTH)
+		return DEFAULT_MIME_TYPE;
+
+	uint32_t seed = MIME_HASH_TABLE.seeds[mimeHash(extension, 0) % BUCKET_COUNT];
+	uint16_t entry = MIME_HASH_TABLE.slots[mimeHash(extension, seed) & (SLOT_COUNT - 1)];
+
+	if (entry != 0 && equalsLowercase(MIME_MAPPINGS[entry - 1].extension, extension))
+		return MIME_MAPPINGS[entry - 1].mime_type;
+
+	return DEFAULT_MIME_TYPE;
+}
+
+// Load extra "type ext1 ext2 ..." lines (mime.types format)
+bool loadMimeTypes(const std::string& file_path)
+{
+	if (extra_mime_types_frozen.load())
+	{
+		std::cout << "[MIME] Table is frozen, ignoring " << file_path << std::endl;
+		return false;
+	}
+
+	std::ifstream file(file_path);
+	if (!file.is_open())
+	{
+		std::cout << "[MIME] Cannot open MIME types file: " << file_path << std::endl;
+		return false;
+	}
+
+	std::string line;
+	size_t loaded = 0;
+	while (std::getline(file, line))
+	{
+		line = line.substr(0, line.find('#'));
+		std::istringstream tokens(line);
+
+		std::string mime_type;
+		if (!(tokens >> mime_type))
+			continue;
+
+		std::string extension;
+		while (tokens >> extension)
+		{
+			if (!extension.empty() && extension[0] == '.')
+				extension.erase(0, 1);
+			for (char& c : extension)
+				c = asciiLower(c);
+			extra_mime_types.push_back({extension, mime_type});
+			loaded++;
+		}
+	}
+
+	// Sort by extension; for duplicates the line loaded last wins
+	std::stable_sort(extra_mime_types.begin(), extra_mime_types.end(),
+		[](const std::pair<std::string, std::string>& a, const std::pair<std::string, std::string>& b)
+		{
+			return a.first < b.first;
+		});
+	for (size_t i = 0; i + 1 < extra_mime_types.size();)
+	{
+		if (extra_mime_types[i].first == extra_mime_types[i + 1].first)
+			extra_mime_types.erase(extra_mime_types.begin() + i);
+		else
+			i++;
+	}
+
+	std::cout << "[MIME] Loaded " << loaded << " extra mappings from " << file_path << std::endl;
+	return true;
+}
+
+// Make the extra mappings visible to lookups
+void freezeMimeTypes()
+{
+	extra_mime_types_frozen.store(true, std::memory_order_release);
+}
@@ -0,0 +1,144 @@
+#include "path_index.h"
+#include "mime_types.h"
+#include "util.h"
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+bool isUploadTempFile(const std::string& path)
+{
+	// Case-insensitive like the file system, so "a.UPLOADING" cannot name a temp file either
+	size_t suffix_length = sizeof(UPLOAD_TEMP_SUFFIX) - 1;
+	return path.length() >= suffix_length && to_lowercase(path.substr(path.length() - suffix_length)) == UPLOAD_TEMP_SUFFIX;
+}
+
+bool isPlainFilePath(const std::string& url_path)
+{
+	size_t pos = 0;
+	while (pos < url_path.length())
+	{
+		size_t next = url_path.find('/', pos + 1);
+		if (next == std::string::npos)
+			next = url_path.length();
+
+		std::string segment = url_path.substr(pos + 1, next - pos - 1);
+		if (segment.find(':') != std::string::npos || (!segment.empty() && (segment.back() == '.' || segment.back() == ' ')))
+			return false;
+		pos = next;
+	}
+	return true;
+}
+
+// Scan webroot recursively and build a new index snapshot
+PathIndex* buildPathIndex(const std::string& webroot)
+{
+	PathIndex* index = new PathIndex();
+	std::error_code ec;
+
+	fs::recursive_directory_iterator it(webroot, fs::directory_options::skip_permission_denied, ec);
+	if (ec)
+	{
+		std::cout << "[PATH_INDEX] Cannot scan webroot " << webroot << ": " << ec.message() << std::endl;
+		return index;
+	}
+
+	for (; it != fs::recursive_directory_iterator(); it.increment(ec))
+	{
+		if (ec)
+			break;
+
+		// symlink_status: links are never followed, so nothing outside the webroot gets indexed
+		if (!fs::is_regular_file(it->symlink_status()))
+			continue;
+
+		FileEntry entry;
+		entry.file_path = it->path().string();
+		if (isUploadTempFile(entry.file_path))
+			continue;
+
+		entry.mime_type = std::string(lookupMimeType(entry.file_path));
+		entry.size = it->file_size(ec);
+		entry.mtime = it->last_write_time(ec);
+
+		// URL key uses forward slashes regardless of the platform separator
+		std::string key = "/" + fs::relative(it->path(), webroot, ec).generic_string();
+		if (ec)
+			continue;
+
+		index->entries.emplace(std::move(key), std::move(entry));
+	}
+
+	std::cout << "[PATH_INDEX] Indexed " << index->entries.size() << " files under " << webroot << std::endl;
+	return index;
+}
+
+// Decode a single hex digit, -1 if invalid
+static int hexValue(char c)
+{
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+// Normalize a request target into an index key
+std::string normalizeUrlPath(const std::string& request_path)
+{
+	// Drop query string and fragment
+	std::string path = request_path.substr(0, request_path.find_first_of("?#"));
+
+	// Percent-decode before segment checks so "%2e%2e" is caught as ".."
+	std::string decoded;
+	decoded.reserve(path.length());
+	for (size_t i = 0; i < path.length(); i++)
+	{
+		if (path[i] == '%' && i + 2 < path.length() && hexValue(path[i + 1]) >= 0 && hexValue(path[i + 2]) >= 0)
+		{
+			decoded += static_cast<char>(hexValue(path[i + 1]) * 16 + hexValue(path[i + 2]));
+			i += 2;
+		}
+		else
+		{
+			decoded += path[i];
+		}
+	}
+
+	// Walk the segments, resolving "." and ".." and rejecting any ".." that would leave the root
+	std::string normalized;
+	size_t depth = 0;
+	size_t pos = 0;
+	while (pos <= decoded.length())
+	{
+		size_t next = decoded.find_first_of("/\\", pos);
+		if (next == std::string::npos)
+			next = decoded.length();
+
+		std::string segment = decoded.substr(pos, next - pos);
+		pos = next + 1;
+
+		if (segment.empty() || segment == ".")
+			continue;
+
+		if (segment.find('\0') != std::string::npos)
+			return "";
+
+		if (segment == "..")
+		{
+			if (depth == 0)
+				return "";
+			normalized.erase(normalized.find_last_of('/'));
+			depth--;
+			continue;
+		}
+
+		normalized += '/';
+		normalized += segment;
+		depth++;
+	}
+
+	// Directory requests ("/" or "/docs/") serve that directory's index.html
+	if (depth == 0 || (!decoded.empty() && (decoded.back() == '/' || decoded.back() == '\\')))
+		normalized += "/index.html";
+
+	return normalized;
+}
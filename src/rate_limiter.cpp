@@ -0,0 +1,183 @@
+#include "rate_limiter.h"
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+
+// Marks a slot's key as used, so address 0.0.0.0 is distinct from a free slot
+const uint64_t KEY_PRESENT = 1ull << 32;
+
+// A slot is not taken over this soon after being claimed, so a thread that has just found it
+// is done charging it before it can change hands (the key is rechecked after each charge)
+const uint64_t CLAIM_GRACE_NS = 1000000000;
+
+static uint64_t clockNs()
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+RateLimiter::RateLimiter(const RateLimitOptions& options)
+{
+	int prefix_bits = std::min(32, std::max(0, options.prefix_bits));
+	prefix_mask = prefix_bits == 0 ? 0 : 0xFFFFFFFFu << (32 - prefix_bits);
+
+	// A burst of n lets the bucket run up to n - 1 intervals ahead of the clock
+	double request_burst = std::max(1.0, options.request_burst > 0 ? options.request_burst : options.requests_per_second);
+	request_interval_ns = options.requests_per_second > 0 ? static_cast<uint64_t>(1e9 / options.requests_per_second) : 0;
+	request_tolerance_ns = static_cast<uint64_t>(request_interval_ns * (request_burst - 1));
+
+	double byte_burst = std::max(options.bytes_per_second, options.byte_burst);
+	byte_interval_ns = options.bytes_per_second > 0 ? 1e9 / options.bytes_per_second : 0;
+	byte_tolerance_ns = static_cast<uint64_t>(byte_interval_ns * byte_burst);
+
+	size_t shard_count = 1;
+	while (shard_count * SLOTS_PER_SHARD < options.table_size)
+		shard_count *= 2;
+	shard_mask = shard_count - 1;
+	slots.reset(new Slot[shard_count * SLOTS_PER_SHARD]);
+
+	std::cout << "[RATE_LIMIT] Per /" << prefix_bits << " client: ";
+	if (request_interval_ns != 0)
+		std::cout << options.requests_per_second << " requests/s (burst " << request_burst << ") ";
+	if (options.bytes_per_second > 0)
+		std::cout << options.bytes_per_second << " bytes/s (burst " << byte_burst << ") ";
+	std::cout << "tracking up to " << shard_count * SLOTS_PER_SHARD << " clients" << std::endl;
+}
+
+uint64_t RateLimiter::clientKey(uint32_t address) const
+{
+	return (address & prefix_mask) | KEY_PRESENT;
+}
+
+RateLimiter::Slot* RateLimiter::findSlot(uint64_t key, uint64_t now_ns)
+{
+	size_t shard = static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 40) & shard_mask;
+	Slot* shard_slots = &slots[shard * SLOTS_PER_SHARD];
+
+	// A lost race on a slot means another thread changed the shard, so look again
+	while (true)
+	{
+		for (size_t i = 0; i < SLOTS_PER_SHARD; i++)
+		{
+			uint64_t current = shard_slots[i].key.load(std::memory_order_acquire);
+			if (current == key)
+				return &shard_slots[i];
+
+			// Claim a free slot; losing the race to the same client is as good as winning it
+			if (current == 0)
+			{
+				if (shard_slots[i].key.compare_exchange_strong(current, key, std::memory_order_acq_rel))
+				{
+					shard_slots[i].claimed_ns.store(now_ns, std::memory_order_relaxed);
+					return &shard_slots[i];
+				}
+				if (current == key)
+					return &shard_slots[i];
+			}
+		}
+
+		// Shard full: take over the slot idle longest. Its buckets restart full (an idle slot's already
+		// are, having refilled); a flood of new addresses can only make busy clients lose their history.
+		// Slots claimed within the grace period are skipped, even though their buckets look idle.
+		Slot* victim = nullptr;
+		uint64_t victim_last = UINT64_MAX;
+		for (size_t i = 0; i < SLOTS_PER_SHARD; i++)
+		{
+			uint64_t claimed = shard_slots[i].claimed_ns.load(std::memory_order_relaxed);
+			if (claimed + CLAIM_GRACE_NS > now_ns)
+				continue;
+
+			uint64_t last = std::max(shard_slots[i].request_tat.load(std::memory_order_relaxed), shard_slots[i].byte_tat.load(std::memory_order_relaxed));
+			if (last < victim_last)
+			{
+				victim = &shard_slots[i];
+				victim_last = last;
+			}
+		}
+
+		if (victim == nullptr)
+			return nullptr;
+
+		// A failed takeover leaves the slot to another client: never charge its buckets
+		uint64_t expected = victim->key.load(std::memory_order_relaxed);
+		if (expected != key && victim->key.compare_exchange_strong(expected, key, std::memory_order_acq_rel))
+		{
+			victim->claimed_ns.store(now_ns, std::memory_order_relaxed);
+			if (victim_last > now_ns)
+			{
+				victim->request_tat.store(0, std::memory_order_relaxed);
+				victim->byte_tat.store(0, std::memory_order_relaxed);
+			}
+			return victim;
+		}
+	}
+}
+
+bool RateLimiter::admitRequest(uint32_t address)
+{
+	uint64_t now = clockNs();
+	uint64_t key = clientKey(address);
+
+	// Recheck the key after charging: a slot taken over meanwhile was charged for its new client,
+	// so the request is charged again in this client's slot
+	while (true)
+	{
+		Slot* slot = findSlot(key, now);
+
+		// Untracked: a client new enough to take over nothing starts with a full bucket anyway
+		if (slot == nullptr)
+			return true;
+
+		// Over the byte budget: refused until enough of it has drained
+		if (byte_interval_ns > 0 && slot->byte_tat.load(std::memory_order_relaxed) > now + byte_tolerance_ns)
+			return false;
+
+		if (request_interval_ns == 0)
+			return true;
+
+		// The bucket refills lazily: a theoretical arrival time in the past is a full bucket
+		uint64_t tat = slot->request_tat.load(std::memory_order_relaxed);
+		bool admitted = true;
+		while (true)
+		{
+			uint64_t base = std::max(tat, now);
+			if (base - now > request_tolerance_ns)
+			{
+				admitted = false;
+				break;
+			}
+
+			if (slot->request_tat.compare_exchange_weak(tat, base + request_interval_ns, std::memory_order_relaxed))
+				break;
+		}
+
+		if (slot->key.load(std::memory_order_acquire) == key)
+			return admitted;
+	}
+}
+
+void RateLimiter::chargeBytes(uint32_t address, size_t bytes)
+{
+	if (byte_interval_ns <= 0 || bytes == 0)
+		return;
+
+	uint64_t now = clockNs();
+	uint64_t key = clientKey(address);
+	uint64_t cost = static_cast<uint64_t>(bytes * byte_interval_ns);
+
+	// Responses are charged after the fact, so the bucket may go into debt
+	while (true)
+	{
+		Slot* slot = findSlot(key, now);
+		if (slot == nullptr)
+			return;
+
+		uint64_t tat = slot->byte_tat.load(std::memory_order_relaxed);
+		while (!slot->byte_tat.compare_exchange_weak(tat, std::max(tat, now) + cost, std::memory_order_relaxed))
+		{
+		}
+
+		if (slot->key.load(std::memory_order_acquire) == key)
+			return;
+	}
+}
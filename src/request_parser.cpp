@@ -170,6 +170,99 @@ void parseHeaders(const std::string& headers_section, RequestData& request)
 	}
 }
 
+// Find where the first request in a (possibly pipelined) buffer ends
+// Returns the total length of headers plus Content-Length body, or npos if more bytes are needed.
+// A body whose end is uncertain would have its bytes read as the next request, so a
+// Transfer-Encoding header or a bad or repeated-but-different Content-Length is an error.
+size_t findRequestEnd(std::string_view buffer)
+{
+	size_t blank_line_pos = buffer.find("\r\n\r\n");
+
+	if (blank_line_pos == std::string_view::npos)
+		return std::string::npos;
+
+	size_t headers_end = blank_line_pos + 4;
+	size_t content_length = 0;
+	bool has_length = false;
+
+	// Scan header lines for the body framing (names are case-insensitive)
+	size_t line_start = buffer.find("\r\n") + 2;
+	while (line_start < blank_line_pos)
+	{
+		size_t line_end = buffer.find("\r\n", line_start);
+		std::string line(buffer.substr(line_start, line_end - line_start));
+		size_t colon_pos = line.find(':');
+
+		std::string name = colon_pos != std::string::npos ? to_lowercase(trim(line.substr(0, colon_pos))) : "";
+
+		if (name == "transfer-encoding")
+			return REQUEST_UNSUPPORTED_ENCODING;
+
+		if (name == "content-length")
+		{
+			// Digits only: no sign, no list, nothing that stoul would quietly accept or truncate
+			std::string value = trim(line.substr(colon_pos + 1));
+			if (value.empty() || value.length() > 18 || value.find_first_not_of("0123456789") != std::string::npos)
+				return REQUEST_BAD_LENGTH;
+
+			size_t length = static_cast<size_t>(std::stoull(value));
+			if (has_length && length != content_length)
+				return REQUEST_BAD_LENGTH;
+
+			content_length = length;
+			has_length = true;
+		}
+
+		line_start = line_end + 2;
+	}
+
+	if (buffer.length() - headers_end < content_length)
+		return std::string::npos;
+
+	return headers_end + content_length;
+}
+
+// Length of the head alone, for requests whose body is streamed rather than buffered
+size_t findHeadEnd(std::string_view buffer)
+{
+	size_t blank_line_pos = buffer.find("\r\n\r\n");
+	return blank_line_pos == std::string_view::npos ? std::string::npos : blank_line_pos + 4;
+}
+
+// Look up a header value by its lowercase name
+std::string getHeader(const RequestData& request, const std::string& name)
+{
+	for (const auto& header : request.headers)
+	{
+		if (header.first == name)
+			return header.second;
+	}
+
+	return "";
+}
+
+std::string_view findHeader(const RequestData& request, std::string_view name)
+{
+	for (const auto& header : request.headers)
+	{
+		if (header.first == name)
+			return header.second;
+	}
+
+	return std::string_view();
+}
+
+// HTTP/1.1 connections persist unless the client asks to close; HTTP/1.0 must opt in
+bool wantsKeepAlive(const RequestData& request)
+{
+	std::string connection = to_lowercase(getHeader(request, "connection"));
+
+	if (request.http_version == "HTTP/1.1")
+		return connection != "close";
+
+	return connection == "keep-alive";
+}
+
 // Read complete request from socket (combines with receiveData)
 std::string readRequestFromSocket(SOCKET client_socket)
 {
@@ -1,63 +1,36 @@
 #include "response_builder.h"
+#include "mime_types.h"
 #include <iostream>
 #include <map>
 #include <sstream>
 
-// Map file extensions to MIME types
-std::map<std::string, std::string> mime_type_map = {
-	{".html", "text/html"},
-	{".htm", "text/html"},
-	{".txt", "text/plain"},
-	{".css", "text/css"},
-	{".js", "application/javascript"},
-	{".json", "application/json"},
-	{".jpeg", "image/jpeg"},
-	{".jpg", "image/jpeg"},
-	{".png", "image/png"},
-	{".gif", "image/gif"},
-	{".svg", "image/svg+xml"},
-	{".ico", "image/x-icon"},
-	{".pdf", "application/pdf"},
-	{".zip", "application/zip"},
-	{"", "application/octet-stream"} // default
-};
-
 // Map status codes to reason phrases
 std::map<int, std::string> status_reason_map = {
+	{101, "Switching Protocols"},
 	{200, "OK"},
 	{201, "Created"},
 	{204, "No Content"},
+	{304, "Not Modified"},
 	{400, "Bad Request"},
 	{403, "Forbidden"},
 	{404, "Not Found"},
 	{405, "Method Not Allowed"},
+	{409, "Conflict"},
+	{411, "Length Required"},
 	{413, "Payload Too Large"},
+	{429, "Too Many Requests"},
 	{500, "Internal Server Error"},
-	{503, "Service Unavailable"}
+	{501, "Not Implemented"},
+	{502, "Bad Gateway"},
+	{503, "Service Unavailable"},
+	{504, "Gateway Timeout"},
+	{507, "Insufficient Storage"}
 };
 
-// Get MIME type from filename extension
+// Get MIME type from filename extension (see mime_types.cpp for the table)
 std::string getMimeType(const std::string& filename)
 {
-	// Find last dot in filename
-	size_t dot_pos = filename.find_last_of('.');
-
-	if (dot_pos == std::string::npos)
-	{
-		// No extension
-		return mime_type_map[""];
-	}
-
-	std::string extension = filename.substr(dot_pos);
-
-	// Look up extension in map
-	if (mime_type_map.find(extension) != mime_type_map.end())
-	{
-		return mime_type_map[extension];
-	}
-
-	// Default for unknown types
-	return mime_type_map[""];
+	return std::string(lookupMimeType(filename));
 }
 
 // Generate error response for given status code
@@ -84,24 +57,85 @@ ResponseData generateErrorResponse(int status_code, const std::string& message)
 // Serialize ResponseData into HTTP response string
 std::string serializeResponse(const ResponseData& response)
 {
-	std::ostringstream response_stream;
+	std::string_view body = responseBody(response);
+	return serializeHeaders(response).append(body.data(), body.length());
+}
+
+// Serialize status line and headers only, so the body can be sent as its own segment
+std::string serializeHeaders(const ResponseData& response)
+{
+	std::string head;
+	head.reserve(256);
+	appendHeaders(response, head);
+	return head;
+}
 
-	// Write status line: HTTP/1.1 200 OK\r\n
-	response_stream << "HTTP/1.1 " << response.status_code << " " << response.reason_phrase << "\r\n";
+// Serialize the `headers` list followed by the blank line that ends the header block
+std::string serializeHeaderLines(const ResponseData& response)
+{
+	std::string lines;
+	appendHeaderLines(response, lines);
+	return lines;
+}
 
+// Append status line (or the precomputed head) and headers to out
+void appendHeaders(const ResponseData& response, std::string& out)
+{
+	if (!response.precomputed_head.empty())
+	{
+		out.append(response.precomputed_head.data(), response.precomputed_head.length());
+	}
+	else
+	{
+		// Write status line: HTTP/1.1 200 OK\r\n
+		out += "HTTP/1.1 ";
+		out += std::to_string(response.status_code);
+		out += ' ';
+		out += response.reason_phrase;
+		out += "\r\n";
+	}
+
+	appendHeaderLines(response, out);
+}
+
+// Append the `headers` list and the terminating blank line to out
+void appendHeaderLines(const ResponseData& response, std::string& out)
+{
 	// Write headers: Header-Name: Header-Value\r\n
 	for (const auto& header : response.headers)
 	{
-		response_stream << header.first << ": " << header.second << "\r\n";
+		out += header.first;
+		out += ": ";
+		out += header.second;
+		out += "\r\n";
 	}
 
 	// Write blank line to separate headers from body
-	response_stream << "\r\n";
+	out += "\r\n";
+}
+
+// The body to send: external bytes when present, otherwise the owned string
+std::string_view responseBody(const ResponseData& response)
+{
+	if (!response.external_body.empty())
+		return response.external_body;
+
+	return response.body;
+}
 
-	// Write body
-	response_stream << response.body;
+// Replace a header value, or add the header if it is not present
+void setHeader(ResponseData& response, const std::string& name, const std::string& value)
+{
+	for (auto& header : response.headers)
+	{
+		if (header.first == name)
+		{
+			header.second = value;
+			return;
+		}
+	}
 
-	return response_stream.str();
+	response.headers.push_back({name, value});
 }
 
 // Helper function to create a successful response for file serving
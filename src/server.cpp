@@ -1,9 +1,24 @@
 #include "server.h"
+#include <ws2tcpip.h>
+#include <cstring>
 
-SocketServer createServerSocket(int Port) {
+// Set one integer socket option, logging (but tolerating) failure: every tuning knob is optional
+static void setIntOption(SOCKET socket_fd, int level, int option, int value, const char* name)
+{
+	if (setsockopt(socket_fd, level, option, (const char*)&value, sizeof(value)) == SOCKET_ERROR)
+	{
+		int lasterror = WSAGetLastError();
+		std::cout << name << " could not be set: " << lasterror << std::endl;
+		return;
+	}
+
+	std::cout << name << " set to " << value << std::endl;
+}
+
+SocketServer createServerSocket(int Port, const ListenerOptions& options) {
 
 	WSADATA wsaData;
-	SocketServer mySocket = {INVALID_SOCKET, 0 };
+	SocketServer mySocket = {INVALID_SOCKET, 0, options};
 	
 	int iResult = WSAStartup(MAKEWORD(2, 2), &wsaData);
 
@@ -38,6 +53,30 @@ SocketServer createServerSocket(int Port) {
 
 	std::cout << "SO_REUSEADDR set successfully" << std::endl;
 
+	// Buffer sizes must be in place before listen() for accepted sockets to inherit them
+	if (options.receive_buffer > 0)
+		setIntOption(listening_socket, SOL_SOCKET, SO_RCVBUF, options.receive_buffer, "SO_RCVBUF");
+	if (options.send_buffer > 0)
+		setIntOption(listening_socket, SOL_SOCKET, SO_SNDBUF, options.send_buffer, "SO_SNDBUF");
+
+	if (options.fast_open_queue > 0)
+	{
+#ifdef TCP_FASTOPEN
+		setIntOption(listening_socket, IPPROTO_TCP, TCP_FASTOPEN, options.fast_open_queue, "TCP_FASTOPEN");
+#else
+		std::cout << "TCP_FASTOPEN is not available on this platform" << std::endl;
+#endif
+	}
+
+	if (options.defer_accept_s > 0)
+	{
+#ifdef TCP_DEFER_ACCEPT
+		setIntOption(listening_socket, IPPROTO_TCP, TCP_DEFER_ACCEPT, options.defer_accept_s, "TCP_DEFER_ACCEPT");
+#else
+		std::cout << "TCP_DEFER_ACCEPT is not available on this platform" << std::endl;
+#endif
+	}
+
 	return mySocket;
 }
 
@@ -61,7 +100,7 @@ void bindSocket(const SocketServer& mySocket)
 
 void listenSocket(const SocketServer& mySocket)
 {
-	if (listen(mySocket.listening_socket, 5) == SOCKET_ERROR)
+	if (listen(mySocket.listening_socket, mySocket.options.backlog) == SOCKET_ERROR)
 	{
 		int lasterror = WSAGetLastError();
 		std::cout << "Can not listen on socket " << lasterror << std::endl;
@@ -74,24 +113,55 @@ void listenSocket(const SocketServer& mySocket)
 
 }
 
-SOCKET acceptConnection(const SocketServer& mySocket)
+int setNonBlocking(SOCKET socket_fd, bool non_blocking)
+{
+	u_long mode = non_blocking ? 1 : 0;
+	if (ioctlsocket(socket_fd, FIONBIO, &mode) == SOCKET_ERROR)
+	{
+		int lasterror = WSAGetLastError();
+		std::cout << "Could not change blocking mode: " << lasterror << std::endl;
+		return SOCKET_ERROR;
+	}
+
+	return 0;
+}
+
+SOCKET acceptConnection(const SocketServer& mySocket, sockaddr_in& peer)
 {
-	sockaddr_in client_addr;
 	int addr_size = sizeof(sockaddr_in);
 
-	SOCKET client_socket = accept(mySocket.listening_socket, (sockaddr*)&client_addr, &addr_size);
+	SOCKET client_socket = accept(mySocket.listening_socket, (sockaddr*)&peer, &addr_size);
 
 	if (client_socket == INVALID_SOCKET)
 	{
+		// An empty queue is the normal end of an accept batch
 		int lasterror = WSAGetLastError();
-		std::cout << "Accept failed with error: " << lasterror << std::endl;
+		if (lasterror != WSAEWOULDBLOCK)
+			std::cout << "Accept failed with error: " << lasterror << std::endl;
+		WSASetLastError(lasterror);
 		return INVALID_SOCKET;
 	}
 
-	std::cout << "Client connected, socket: " << client_socket << std::endl;
+	// Winsock hands out accepted sockets with the listener's non-blocking mode;
+	// client threads rely on blocking calls with receive timeouts
+	setNonBlocking(client_socket, false);
+
+	if (mySocket.options.no_delay)
+	{
+		int no_delay = 1;
+		setsockopt(client_socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&no_delay, sizeof(no_delay));
+	}
+
 	return client_socket;
 }
 
+std::string formatAddress(const sockaddr_in& address)
+{
+	char text[INET_ADDRSTRLEN] = "";
+	inet_ntop(AF_INET, &address.sin_addr, text, sizeof(text));
+	return std::string(text) + ":" + std::to_string(ntohs(address.sin_port));
+}
+
 int sendData(SOCKET client_socket, const std::string& data)
 {
 	int total_bytes_sent = 0;
@@ -161,6 +231,183 @@ std::string receiveData(SOCKET client_socket)
 
 }
 
+int receiveChunk(SOCKET client_socket, std::string& buffer)
+{
+	char chunk[4096];
+
+	int bytes_received = recv(client_socket, chunk, sizeof(chunk), 0);
+
+	if (bytes_received == SOCKET_ERROR)
+	{
+		int lasterror = WSAGetLastError();
+		if (lasterror != WSAETIMEDOUT)
+			std::cout << "Receive failed with error: " << lasterror << std::endl;
+		return -1;
+	}
+
+	buffer.append(chunk, bytes_received);
+	return bytes_received;
+}
+
+int receiveChunk(SOCKET client_socket, IoBuffer& buffer)
+{
+	int bytes_received = recv(client_socket, buffer.writePointer(), static_cast<int>(buffer.writable()), 0);
+
+	if (bytes_received == SOCKET_ERROR)
+	{
+		int lasterror = WSAGetLastError();
+		if (lasterror != WSAETIMEDOUT)
+			std::cout << "Receive failed with error: " << lasterror << std::endl;
+		return -1;
+	}
+
+	buffer.commit(bytes_received);
+	return bytes_received;
+}
+
+int waitForData(SOCKET client_socket)
+{
+	// Peeking one byte needs no buffer, so an idle connection holds none while it waits
+	char probe;
+	int result = recv(client_socket, &probe, 1, MSG_PEEK);
+
+	if (result == SOCKET_ERROR)
+	{
+		int lasterror = WSAGetLastError();
+		if (lasterror != WSAETIMEDOUT)
+			std::cout << "Receive failed with error: " << lasterror << std::endl;
+		return -1;
+	}
+
+	return result;
+}
+
+void queueData(OutputQueue& queue, std::string data)
+{
+	if (data.empty())
+		return;
+
+	// Move the string into shared storage so the segment can point straight at it
+	auto owned = std::make_shared<const std::string>(std::move(data));
+	queueSlice(queue, owned, owned->data(), owned->length());
+}
+
+void queueSlice(OutputQueue& queue, std::shared_ptr<const void> owner, const char* data, size_t length)
+{
+	if (length == 0)
+		return;
+
+	queue.segments.push_back({std::move(owner), data, length});
+	queue.queued_bytes += length;
+}
+
+void queueCopy(OutputQueue& queue, const char* data, size_t length)
+{
+	if (length == 0)
+		return;
+
+	// Larger than a block: give it its own storage
+	if (length > BUFFER_SIZE_CLASSES[0])
+	{
+		queueData(queue, std::string(data, length));
+		return;
+	}
+
+	if (queue.blocks.empty() || queue.blocks.back().capacity - queue.block_used < length)
+	{
+		queue.blocks.push_back(acquireBuffer(BUFFER_SIZE_CLASSES[0]));
+		queue.block_used = 0;
+	}
+
+	char* destination = queue.blocks.back().data + queue.block_used;
+	std::memcpy(destination, data, length);
+	queue.block_used += length;
+	queue.queued_bytes += length;
+
+	// Consecutive copies into the same block go out as one buffer
+	if (!queue.segments.empty())
+	{
+		OutputSegment& last = queue.segments.back();
+		if (!last.owner && last.data + last.length == destination)
+		{
+			last.length += length;
+			return;
+		}
+	}
+
+	queue.segments.push_back({nullptr, destination, length});
+}
+
+void releaseOutputBlocks(OutputQueue& queue)
+{
+	for (PooledBuffer& block : queue.blocks)
+		releaseBuffer(block);
+	queue.blocks.clear();
+	queue.block_used = 0;
+}
+
+OutputQueue::~OutputQueue()
+{
+	releaseOutputBlocks(*this);
+}
+
+int flushOutput(SOCKET client_socket, OutputQueue& queue)
+{
+	const size_t max_buffers = 64; // WSABUFs handed to one WSASend call
+	WSABUF buffers[max_buffers];
+	int total_bytes_sent = 0;
+
+	while (!queue.segments.empty())
+	{
+		// Gather as many queued segments as fit into one call; pipelined responses
+		// leave together instead of as one small packet per response
+		DWORD buffer_count = 0;
+		for (const auto& segment : queue.segments)
+		{
+			if (buffer_count == max_buffers)
+				break;
+			buffers[buffer_count].buf = const_cast<char*>(segment.data);
+			buffers[buffer_count].len = static_cast<ULONG>(segment.length);
+			buffer_count++;
+		}
+
+		DWORD bytes_sent = 0;
+		if (WSASend(client_socket, buffers, buffer_count, &bytes_sent, 0, nullptr, nullptr) == SOCKET_ERROR)
+		{
+			int lasterror = WSAGetLastError();
+			if (lasterror == WSAEWOULDBLOCK)
+				return total_bytes_sent; // Remaining segments stay queued for the next flush
+
+			std::cout << "Could not send data: " << lasterror << std::endl;
+			return -1;
+		}
+
+		if (bytes_sent == 0)
+			return total_bytes_sent;
+
+		total_bytes_sent += bytes_sent;
+		queue.queued_bytes -= bytes_sent;
+
+		// Drop fully sent segments and advance into a partially sent one
+		size_t remaining = bytes_sent;
+		while (remaining > 0)
+		{
+			OutputSegment& front = queue.segments.front();
+			if (remaining < front.length)
+			{
+				front.data += remaining;
+				front.length -= remaining;
+				break;
+			}
+			remaining -= front.length;
+			queue.segments.pop_front();
+		}
+	}
+
+	releaseOutputBlocks(queue);
+	return total_bytes_sent;
+}
+
 
 void closeSocket(SOCKET socket_fd)
 {
@@ -0,0 +1,274 @@
+#include "tls.h"
+#include <iostream>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#ifdef HTTP_ENABLE_TLS
+
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+struct TlsContext {
+	SSL_CTX* ssl_context;
+};
+
+struct TlsStream {
+	SSL* ssl;
+	bool kernel_send;   // Record encryption for writes happens in the kernel (kTLS)
+};
+
+// Print the message followed by everything on this thread's OpenSSL error queue
+static void logTlsErrors(const std::string& message)
+{
+	std::cout << "[TLS] " << message << std::endl;
+
+	unsigned long error;
+	while ((error = ERR_get_error()) != 0)
+	{
+		char text[256];
+		ERR_error_string_n(error, text, sizeof(text));
+		std::cout << "[TLS]   " << text << std::endl;
+	}
+}
+
+TlsContext* createTlsContext(const std::string& cert_file, const std::string& key_file)
+{
+	SSL_CTX* ssl_context = SSL_CTX_new(TLS_server_method());
+	if (ssl_context == nullptr)
+	{
+		logTlsErrors("Cannot create TLS context");
+		return nullptr;
+	}
+
+	SSL_CTX_set_min_proto_version(ssl_context, TLS1_2_VERSION);
+
+	if (SSL_CTX_use_certificate_chain_file(ssl_context, cert_file.c_str()) != 1 ||
+		SSL_CTX_use_PrivateKey_file(ssl_context, key_file.c_str(), SSL_FILETYPE_PEM) != 1 ||
+		SSL_CTX_check_private_key(ssl_context) != 1)
+	{
+		logTlsErrors("Cannot load certificate " + cert_file + " / key " + key_file);
+		SSL_CTX_free(ssl_context);
+		return nullptr;
+	}
+
+	// Resumption skips the full handshake: stateless session tickets for clients that
+	// support them, plus a server-side cache for clients that only send a session ID
+	static const unsigned char session_id_context[] = "HTTP_Server";
+	SSL_CTX_set_session_cache_mode(ssl_context, SSL_SESS_CACHE_SERVER);
+	SSL_CTX_set_session_id_context(ssl_context, session_id_context, sizeof(session_id_context) - 1);
+	SSL_CTX_sess_set_cache_size(ssl_context, TLS_SESSION_CACHE_SIZE);
+	SSL_CTX_set_timeout(ssl_context, TLS_SESSION_LIFETIME_S);
+	SSL_CTX_clear_options(ssl_context, SSL_OP_NO_TICKET);
+	SSL_CTX_set_num_tickets(ssl_context, 1);
+
+	// Idle keep-alive connections hand their record buffers back
+	SSL_CTX_set_mode(ssl_context, SSL_MODE_RELEASE_BUFFERS);
+
+#ifdef SSL_OP_IGNORE_UNEXPECTED_EOF
+	// Clients routinely close without close_notify; treat that like a normal close
+	SSL_CTX_set_options(ssl_context, SSL_OP_IGNORE_UNEXPECTED_EOF);
+#endif
+
+#ifdef SSL_OP_ENABLE_KTLS
+	// After the handshake, let the kernel do record encryption when OpenSSL and the OS support it
+	SSL_CTX_set_options(ssl_context, SSL_OP_ENABLE_KTLS);
+#endif
+
+	std::cout << "[TLS] Loaded certificate " << cert_file << std::endl;
+	return new TlsContext{ssl_context};
+}
+
+void destroyTlsContext(TlsContext* context)
+{
+	if (context == nullptr)
+		return;
+
+	SSL_CTX_free(context->ssl_context);
+	delete context;
+}
+
+TlsStream* acceptTls(TlsContext* context, SOCKET client_socket)
+{
+	SSL* ssl = SSL_new(context->ssl_context);
+	if (ssl == nullptr)
+	{
+		logTlsErrors("Cannot create TLS session");
+		return nullptr;
+	}
+
+	ERR_clear_error();
+	SSL_set_fd(ssl, static_cast<int>(client_socket));
+	if (SSL_accept(ssl) != 1)
+	{
+		logTlsErrors("Handshake failed");
+		SSL_free(ssl);
+		return nullptr;
+	}
+
+	TlsStream* stream = new TlsStream{ssl, false};
+#ifdef BIO_get_ktls_send
+	stream->kernel_send = BIO_get_ktls_send(SSL_get_wbio(ssl)) != 0;
+#endif
+
+	std::cout << "[TLS] Handshake complete: " << SSL_get_version(ssl) << " " << SSL_get_cipher_name(ssl)
+		<< (SSL_session_reused(ssl) ? ", resumed" : ", full")
+		<< (stream->kernel_send ? ", kernel TLS" : "") << std::endl;
+	return stream;
+}
+
+int tlsReceiveChunk(TlsStream* stream, IoBuffer& buffer)
+{
+	ERR_clear_error();
+	int bytes_received = SSL_read(stream->ssl, buffer.writePointer(), static_cast<int>(buffer.writable()));
+	if (bytes_received > 0)
+	{
+		buffer.commit(bytes_received);
+		return bytes_received;
+	}
+
+	int error = SSL_get_error(stream->ssl, bytes_received);
+	if (error == SSL_ERROR_ZERO_RETURN)
+		return 0;
+
+	// SYSCALL covers the keep-alive receive timeout, which is not worth reporting
+	if (error != SSL_ERROR_SYSCALL)
+		logTlsErrors("Receive failed with error: " + std::to_string(error));
+	return -1;
+}
+
+static int writeAll(TlsStream* stream, const char* data, size_t length)
+{
+	size_t total_bytes_sent = 0;
+	while (total_bytes_sent < length)
+	{
+		int chunk = static_cast<int>(std::min<size_t>(length - total_bytes_sent, INT_MAX));
+
+		ERR_clear_error();
+		int result = SSL_write(stream->ssl, data + total_bytes_sent, chunk);
+		if (result <= 0)
+		{
+			logTlsErrors("Could not send data: " + std::to_string(SSL_get_error(stream->ssl, result)));
+			return -1;
+		}
+
+		total_bytes_sent += result;
+	}
+
+	return static_cast<int>(total_bytes_sent);
+}
+
+int tlsSendData(TlsStream* stream, const std::string& data)
+{
+	return writeAll(stream, data.data(), data.length());
+}
+
+int tlsFlushOutput(TlsStream* stream, OutputQueue& queue)
+{
+	// Every SSL_write ends in at least one record, so a header segment written on its own
+	// would cost a record and a send. Small segments are gathered into one record instead;
+	// segments of a full record or more are written straight from their owner's memory.
+	PooledBuffer staging;
+	size_t staged = 0;
+	int total_bytes_sent = 0;
+	int result = 0;
+
+	while (!queue.segments.empty() && result >= 0)
+	{
+		const OutputSegment& front = queue.segments.front();
+
+		if (staged > 0 && staged + front.length > TLS_RECORD_SIZE)
+		{
+			result = writeAll(stream, staging.data, staged);
+			total_bytes_sent += static_cast<int>(staged);
+			staged = 0;
+		}
+
+		if (front.length >= TLS_RECORD_SIZE)
+		{
+			if (result >= 0)
+				result = writeAll(stream, front.data, front.length);
+			total_bytes_sent += static_cast<int>(front.length);
+		}
+		else
+		{
+			if (staging.data == nullptr)
+				staging = acquireBuffer(TLS_RECORD_SIZE);
+			std::memcpy(staging.data + staged, front.data, front.length);
+			staged += front.length;
+		}
+
+		queue.queued_bytes -= front.length;
+		queue.segments.pop_front();
+	}
+
+	if (staged > 0 && result >= 0)
+	{
+		result = writeAll(stream, staging.data, staged);
+		total_bytes_sent += static_cast<int>(staged);
+	}
+
+	releaseBuffer(staging);
+	if (queue.segments.empty())
+		releaseOutputBlocks(queue);
+	return result < 0 ? -1 : total_bytes_sent;
+}
+
+bool tlsHasPending(TlsStream* stream)
+{
+	return SSL_pending(stream->ssl) > 0;
+}
+
+void closeTls(TlsStream* stream)
+{
+	if (stream == nullptr)
+		return;
+
+	SSL_shutdown(stream->ssl);
+	SSL_free(stream->ssl);
+	delete stream;
+}
+
+#else
+
+TlsContext* createTlsContext(const std::string& cert_file, const std::string& key_file)
+{
+	std::cout << "[TLS] TLS support is not compiled in (configure with -DHTTP_ENABLE_TLS=ON); cannot use "
+		<< cert_file << " / " << key_file << std::endl;
+	return nullptr;
+}
+
+void destroyTlsContext(TlsContext*)
+{
+}
+
+TlsStream* acceptTls(TlsContext*, SOCKET)
+{
+	return nullptr;
+}
+
+int tlsReceiveChunk(TlsStream*, IoBuffer&)
+{
+	return -1;
+}
+
+int tlsSendData(TlsStream*, const std::string&)
+{
+	return -1;
+}
+
+int tlsFlushOutput(TlsStream*, OutputQueue&)
+{
+	return -1;
+}
+
+bool tlsHasPending(TlsStream*)
+{
+	return false;
+}
+
+void closeTls(TlsStream*)
+{
+}
+
+#endif
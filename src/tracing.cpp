@@ -0,0 +1,198 @@
+#include "tracing.h"
+#include "util.h"
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+
+unsigned int trace_sample_rate = 0;
+thread_local uint64_t trace_request_id = 0;
+
+namespace {
+
+struct TraceEvent {
+	const char* name;      // Phase name (literal), or nullptr for the whole-request span
+	std::string label;     // Whole-request span only
+	uint64_t start_ns;
+	uint64_t duration_ns;
+	uint64_t request_id;
+	unsigned int thread_id;
+};
+
+std::mutex global_mutex;
+std::vector<TraceEvent> global_events;
+size_t max_global_events = 0;
+size_t dropped_events = 0;
+
+std::atomic<uint64_t> next_request_id(1);
+std::atomic<unsigned int> next_thread_id(1);
+const uint64_t clock_origin_ns = traceClockNs();
+
+// Per-thread buffer; a finishing connection thread hands its events to the global list
+struct ThreadTrace {
+	std::vector<TraceEvent> events;
+	unsigned int thread_id = 0;
+	uint32_t random_state = 0;        // xorshift32, seeded on first use
+	uint64_t request_start_ns = 0;
+
+	~ThreadTrace() { flush(); }
+
+	void flush()
+	{
+		if (events.empty())
+			return;
+
+		std::lock_guard<std::mutex> lock(global_mutex);
+		for (TraceEvent& event : events)
+		{
+			if (global_events.size() < max_global_events)
+				global_events.push_back(std::move(event));
+			else
+				dropped_events++;
+		}
+		events.clear();
+	}
+
+	void record(TraceEvent event)
+	{
+		if (events.empty())
+			events.reserve(TRACE_THREAD_BUFFER_EVENTS);
+
+		events.push_back(std::move(event));
+		if (events.size() >= TRACE_THREAD_BUFFER_EVENTS)
+			flush();
+	}
+};
+
+thread_local ThreadTrace thread_trace;
+
+// Request paths are client bytes: anything that is not valid UTF-8 becomes U+FFFD
+void writeJsonString(std::ostream& out, const std::string& text)
+{
+	out << '"';
+	for (size_t pos = 0; pos < text.length(); pos++)
+	{
+		char c = text[pos];
+		if (c == '"' || c == '\\')
+			out << '\\' << c;
+		else if (static_cast<unsigned char>(c) < 0x20)
+		{
+			char escaped[8];
+			std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+			out << escaped;
+		}
+		else if (static_cast<unsigned char>(c) < 0x80)
+			out << c;
+		else if (size_t length = utf8SequenceLength(text, pos))
+		{
+			out.write(text.data() + pos, length);
+			pos += length - 1;
+		}
+		else
+			out << "\\ufffd";
+	}
+	out << '"';
+}
+
+}
+
+uint64_t traceClockNs()
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void configureTracing(unsigned int sample_rate, size_t max_events)
+{
+	trace_sample_rate = sample_rate;
+	max_global_events = max_events;
+
+	if (sample_rate != 0)
+		std::cout << "[TRACE] Tracing 1 in " << sample_rate << " requests (up to " << max_events << " events)" << std::endl;
+}
+
+void traceSampleRequest()
+{
+	// Random rather than every Nth per thread: with a thread per connection, a per-thread
+	// counter would pick the first request of every connection
+	uint32_t& state = thread_trace.random_state;
+	if (state == 0)
+		state = (static_cast<uint32_t>(traceClockNs()) ^ static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&state))) | 1;
+
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	if (state % trace_sample_rate != 0)
+		return;
+
+	if (thread_trace.thread_id == 0)
+		thread_trace.thread_id = next_thread_id++;
+
+	trace_request_id = next_request_id++;
+	thread_trace.request_start_ns = traceClockNs();
+}
+
+void traceRequestEnd(const std::string& label)
+{
+	if (trace_request_id == 0)
+		return;
+
+	uint64_t now = traceClockNs();
+	thread_trace.record({nullptr, label, thread_trace.request_start_ns, now - thread_trace.request_start_ns,
+		trace_request_id, thread_trace.thread_id});
+}
+
+void traceSpanEnd(const char* name, uint64_t start_ns)
+{
+	if (trace_request_id == 0)
+		return;
+
+	thread_trace.record({name, std::string(), start_ns, traceClockNs() - start_ns, trace_request_id, thread_trace.thread_id});
+}
+
+void flushThreadTrace()
+{
+	thread_trace.flush();
+}
+
+bool writeChromeTrace(const std::string& file_path)
+{
+	flushThreadTrace();
+
+	std::ofstream out(file_path, std::ios::binary);
+	if (!out.is_open())
+	{
+		std::cout << "[TRACE] Cannot write " << file_path << std::endl;
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(global_mutex);
+
+	// Complete ("X") events in microseconds; each connection thread is its own track
+	out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+	bool first = true;
+	for (const TraceEvent& event : global_events)
+	{
+		out << (first ? "" : ",\n") << "{\"name\":";
+		writeJsonString(out, event.name != nullptr ? std::string(event.name) : event.label);
+
+		char times[96];
+		std::snprintf(times, sizeof(times), ",\"ts\":%.3f,\"dur\":%.3f",
+			(event.start_ns - clock_origin_ns) / 1000.0, event.duration_ns / 1000.0);
+
+		out << ",\"cat\":\"" << (event.name != nullptr ? "phase" : "request") << "\",\"ph\":\"X\""
+			<< times << ",\"pid\":1,\"tid\":" << event.thread_id
+			<< ",\"args\":{\"request\":" << event.request_id << "}}";
+		first = false;
+	}
+	out << "\n]}\n";
+
+	std::cout << "[TRACE] Wrote " << global_events.size() << " events to " << file_path;
+	if (dropped_events > 0)
+		std::cout << " (" << dropped_events << " dropped over the event limit)";
+	std::cout << std::endl;
+	return true;
+}
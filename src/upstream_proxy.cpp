@@ -0,0 +1,517 @@
+#include "upstream_proxy.h"
+#include "server.h"
+#include "util.h"
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <ws2tcpip.h>
+
+// Hop-by-hop headers are meaningful for a single connection and are never forwarded
+static bool isHopByHopHeader(const std::string& lowercase_name)
+{
+	return lowercase_name == "connection" || lowercase_name == "keep-alive" || lowercase_name == "proxy-connection" ||
+		lowercase_name == "te" || lowercase_name == "trailer" || lowercase_name == "upgrade" ||
+		lowercase_name == "transfer-encoding";
+}
+
+// The proxy buffers the whole request body before forwarding, so the backend must not be
+// asked to confirm it first; its 100 Continue would only delay the real response
+static bool isDroppedRequestHeader(const std::string& lowercase_name)
+{
+	return isHopByHopHeader(lowercase_name) || lowercase_name == "expect";
+}
+
+// True if the buffered response head is an interim 1xx one (e.g. 100 Continue)
+static bool isInterimHead(const std::string& buffer)
+{
+	size_t status_start = buffer.find(' ');
+	return buffer.compare(0, 5, "HTTP/") == 0 && status_start != std::string::npos &&
+		status_start + 1 < buffer.length() && buffer[status_start + 1] == '1';
+}
+
+// Idempotent methods may be sent again when it is unknown whether the backend acted on them
+static bool isIdempotentMethod(const std::string& method)
+{
+	return method == "GET" || method == "HEAD" || method == "PUT" || method == "DELETE" || method == "OPTIONS";
+}
+
+static long long steadyNowMs()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Tracks chunked transfer-encoding framing while the raw bytes are passed through
+struct ChunkedDecoder {
+	enum Phase { SizeLine, Data, DataEnd, Trailer, Done };
+	Phase phase = SizeLine;
+	unsigned long long remaining = 0;
+	std::string line;
+	bool malformed = false;
+	size_t consumed = 0;   // Bytes of the last consume() call that belonged to the body
+
+	// Consume bytes; returns true once the terminating chunk and trailers have been seen
+	bool consume(const char* data, size_t length)
+	{
+		size_t i = 0;
+		while (i < length && phase != Done)
+		{
+			if (phase == Data)
+			{
+				size_t take = static_cast<size_t>(std::min<unsigned long long>(remaining, length - i));
+				i += take;
+				remaining -= take;
+				if (remaining == 0)
+					phase = DataEnd;
+				continue;
+			}
+
+			char c = data[i++];
+			if (c == '\r')
+				continue;
+
+			if (c != '\n')
+			{
+				if (phase != DataEnd)
+					line += c;
+				continue;
+			}
+
+			if (phase == SizeLine)
+			{
+				try
+				{
+					remaining = std::stoull(line.substr(0, line.find(';')), nullptr, 16);
+				}
+				catch (const std::exception&)
+				{
+					malformed = true;
+					consumed = i;
+					return true;
+				}
+				phase = remaining == 0 ? Trailer : Data;
+			}
+			else if (phase == DataEnd)
+			{
+				phase = SizeLine;
+			}
+			else if (phase == Trailer && line.empty())
+			{
+				phase = Done;
+			}
+			line.clear();
+		}
+
+		consumed = i;
+		return phase == Done;
+	}
+};
+
+// Build the routing table from config; backends that do not resolve are skipped
+UpstreamProxy::UpstreamProxy(const std::vector<ProxyRouteConfig>& route_configs, BalancePolicy policy) : policy(policy)
+{
+	for (const auto& route_config : route_configs)
+	{
+		std::unique_ptr<UpstreamRoute> route(new UpstreamRoute());
+		route->prefix = route_config.prefix;
+
+		for (const auto& target : route_config.backends)
+		{
+			std::unique_ptr<Backend> backend(new Backend());
+			size_t colon_pos = target.rfind(':');
+			backend->host = target.substr(0, colon_pos);
+			backend->port = colon_pos == std::string::npos ? 80 : std::stoi(target.substr(colon_pos + 1));
+
+			backend->address = {};
+			backend->address.sin_family = AF_INET;
+			backend->address.sin_port = htons(backend->port);
+			if (inet_pton(AF_INET, backend->host.c_str(), &backend->address.sin_addr) != 1)
+			{
+				std::cout << "[PROXY] Backend must be an IPv4 address: " << target << std::endl;
+				continue;
+			}
+
+			route->backends.push_back(std::move(backend));
+		}
+
+		if (route->backends.empty())
+			continue;
+
+		std::cout << "[PROXY] " << route->prefix << " -> " << route->backends.size() << " backend(s)" << std::endl;
+		routes.push_back(std::move(route));
+	}
+
+	// Longest prefix first so matchRoute can stop at the first hit
+	std::sort(routes.begin(), routes.end(), [](const std::unique_ptr<UpstreamRoute>& a, const std::unique_ptr<UpstreamRoute>& b)
+	{
+		return a->prefix.length() > b->prefix.length();
+	});
+}
+
+UpstreamProxy::~UpstreamProxy()
+{
+	for (auto& route : routes)
+	{
+		for (auto& backend : route->backends)
+		{
+			for (SOCKET idle : backend->idle_connections)
+				closesocket(idle);
+		}
+	}
+}
+
+// Longest configured prefix matching the path
+UpstreamRoute* UpstreamProxy::matchRoute(const std::string& path)
+{
+	for (auto& route : routes)
+	{
+		if (path.compare(0, route->prefix.length(), route->prefix) == 0)
+			return route.get();
+	}
+
+	return nullptr;
+}
+
+// Pick a healthy backend by policy
+Backend* UpstreamProxy::chooseBackend(UpstreamRoute& route)
+{
+	long long now = steadyNowMs();
+	size_t count = route.backends.size();
+	size_t start = route.next_backend.fetch_add(1) % count;
+
+	Backend* chosen = nullptr;
+	for (size_t i = 0; i < count; i++)
+	{
+		Backend* candidate = route.backends[(start + i) % count].get();
+		if (candidate->down_until_ms.load() > now)
+			continue;
+
+		if (policy == BalancePolicy::RoundRobin)
+			return candidate;
+
+		// Least connections; the rotating start spreads ties evenly
+		if (chosen == nullptr || candidate->active_requests.load() < chosen->active_requests.load())
+			chosen = candidate;
+	}
+
+	if (chosen != nullptr)
+		return chosen;
+
+	// Everything is marked down: probe the backend whose retry time comes first
+	chosen = route.backends[0].get();
+	for (auto& backend : route.backends)
+	{
+		if (backend->down_until_ms.load() < chosen->down_until_ms.load())
+			chosen = backend.get();
+	}
+	return chosen;
+}
+
+// Reuse an idle pooled connection or open a new one
+SOCKET UpstreamProxy::acquireConnection(Backend& backend, bool& reused)
+{
+	{
+		std::lock_guard<std::mutex> lock(backend.pool_mutex);
+		if (!backend.idle_connections.empty())
+		{
+			SOCKET pooled = backend.idle_connections.back();
+			backend.idle_connections.pop_back();
+			reused = true;
+			return pooled;
+		}
+	}
+
+	reused = false;
+	SOCKET upstream_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (upstream_socket == INVALID_SOCKET)
+		return INVALID_SOCKET;
+
+	DWORD timeout_ms = UPSTREAM_TIMEOUT_MS;
+	setsockopt(upstream_socket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout_ms, sizeof(timeout_ms));
+	setsockopt(upstream_socket, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout_ms, sizeof(timeout_ms));
+	int no_delay = 1;
+	setsockopt(upstream_socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&no_delay, sizeof(no_delay));
+
+	if (connect(upstream_socket, (const sockaddr*)&backend.address, sizeof(backend.address)) == SOCKET_ERROR)
+	{
+		std::cout << "[PROXY] Cannot connect to " << backend.host << ":" << backend.port << " error " << WSAGetLastError() << std::endl;
+		closesocket(upstream_socket);
+		return INVALID_SOCKET;
+	}
+
+	return upstream_socket;
+}
+
+void UpstreamProxy::releaseConnection(Backend& backend, SOCKET upstream_socket)
+{
+	{
+		std::lock_guard<std::mutex> lock(backend.pool_mutex);
+		if (backend.idle_connections.size() < UPSTREAM_MAX_IDLE)
+		{
+			backend.idle_connections.push_back(upstream_socket);
+			return;
+		}
+	}
+
+	closesocket(upstream_socket);
+}
+
+void UpstreamProxy::recordSuccess(Backend& backend)
+{
+	backend.consecutive_failures = 0;
+	backend.down_until_ms = 0;
+}
+
+void UpstreamProxy::recordFailure(Backend& backend, bool refused)
+{
+	if (++backend.consecutive_failures >= UPSTREAM_MAX_FAILURES || refused)
+	{
+		backend.down_until_ms = steadyNowMs() + UPSTREAM_RETRY_AFTER_MS;
+		std::cout << "[PROXY] Marking " << backend.host << ":" << backend.port << " down" << std::endl;
+	}
+}
+
+// Send the request and read until the response head is complete.
+// Returns the upstream socket, or INVALID_SOCKET with `connected` telling whether the request left.
+SOCKET UpstreamProxy::exchangeHead(Backend& backend, const std::string& upstream_request, bool idempotent,
+	std::string& buffer, size_t& head_end, bool& connected)
+{
+	connected = false;
+
+	// A pooled connection may have been closed by the backend while idle; retry once on a fresh one.
+	// A request that was sent may have been processed before the close, so only idempotent ones go again.
+	for (int attempt = 0; attempt < 2; attempt++)
+	{
+		bool reused = false;
+		SOCKET upstream_socket = acquireConnection(backend, reused);
+		if (upstream_socket == INVALID_SOCKET)
+			return INVALID_SOCKET;
+		connected = true;
+
+		buffer.clear();
+		head_end = std::string::npos;
+		bool send_failed = sendData(upstream_socket, upstream_request) < 0;
+		bool failed = send_failed;
+		while (!failed && head_end == std::string::npos)
+		{
+			if (receiveChunk(upstream_socket, buffer) <= 0)
+			{
+				failed = true;
+				continue;
+			}
+
+			// Interim responses come before the final one; they carry no body and are skipped
+			head_end = buffer.find("\r\n\r\n");
+			while (head_end != std::string::npos && isInterimHead(buffer))
+			{
+				buffer.erase(0, head_end + 4);
+				head_end = buffer.find("\r\n\r\n");
+			}
+
+			// A head that never ends would otherwise be buffered without limit
+			if (head_end == std::string::npos && buffer.length() > UPSTREAM_MAX_HEAD_SIZE)
+			{
+				std::cout << "[PROXY] Response head from " << backend.host << ":" << backend.port << " too large" << std::endl;
+				WSASetLastError(WSAEMSGSIZE);
+				failed = true;
+			}
+		}
+
+		if (!failed)
+			return upstream_socket;
+
+		int error = WSAGetLastError();
+		closesocket(upstream_socket);
+		WSASetLastError(error);
+		if (!reused || !buffer.empty() || (!send_failed && !idempotent))
+			break;  // Only a stale pooled connection that produced nothing is retried
+	}
+
+	return INVALID_SOCKET;
+}
+
+// Forward a request and stream the response to the client socket
+bool UpstreamProxy::forwardRequest(UpstreamRoute& route, SOCKET client_socket, TlsStream* client_tls, const RequestData& request,
+	bool& keep_alive, ResponseData& error_response, uint64_t& sent_bytes)
+{
+	sent_bytes = 0;
+	auto sendToClient = [&](const std::string& data)
+	{
+		int result = client_tls != nullptr ? tlsSendData(client_tls, data) : sendData(client_socket, data);
+		if (result >= 0)
+			sent_bytes += data.length();
+		return result;
+	};
+
+	// Rebuild the request head without hop-by-hop headers; the upstream hop is always keep-alive.
+	// Bodies are Content-Length only: findRequestEnd answers any Transfer-Encoding with 501 first.
+	std::string upstream_request = request.method + " " + request.path + " HTTP/1.1\r\n";
+	for (const auto& header : request.headers)
+	{
+		if (!isDroppedRequestHeader(header.first))
+			upstream_request += header.first + ": " + header.second + "\r\n";
+	}
+	upstream_request += "Connection: keep-alive\r\n\r\n";
+	upstream_request += request.body;
+
+	// A backend that refuses the connection never saw the request, so the next one can take it.
+	// Once the request has been sent it is not replayed elsewhere.
+	Backend* chosen = nullptr;
+	SOCKET upstream_socket = INVALID_SOCKET;
+	std::string buffer;
+	size_t head_end = std::string::npos;
+	bool connected = false;
+	for (size_t attempt = 0; attempt < route.backends.size(); attempt++)
+	{
+		chosen = chooseBackend(route);
+		chosen->active_requests++;
+		upstream_socket = exchangeHead(*chosen, upstream_request, isIdempotentMethod(request.method), buffer, head_end, connected);
+		if (upstream_socket != INVALID_SOCKET)
+			break;
+
+		chosen->active_requests--;
+		recordFailure(*chosen, !connected);
+		if (connected)
+			break;
+	}
+
+	if (upstream_socket == INVALID_SOCKET)
+	{
+		int error = WSAGetLastError();
+		error_response = error == WSAETIMEDOUT ? generateErrorResponse(504, "Gateway Timeout") : generateErrorResponse(502, "Bad Gateway");
+		return false;
+	}
+
+	Backend& backend = *chosen;
+
+	// Parse the upstream status line and framing headers
+	std::string head = buffer.substr(0, head_end);
+	size_t status_end = std::min(head.find("\r\n"), head.length());
+	std::vector<std::string> status_tokens = split(head.substr(0, status_end), ' ');
+	int status_code = status_tokens.size() >= 2 ? std::atoi(status_tokens[1].c_str()) : 0;
+
+	bool chunked = false;
+	bool has_length = false;
+	unsigned long long content_length = 0;
+	bool upstream_close = false;
+	std::string client_head = head.substr(0, status_end) + "\r\n";
+
+	size_t line_start = status_end + 2;
+	while (line_start < head.length())
+	{
+		size_t line_end = head.find("\r\n", line_start);
+		if (line_end == std::string::npos)
+			line_end = head.length();
+		std::string line = head.substr(line_start, line_end - line_start);
+		line_start = line_end + 2;
+
+		size_t colon_pos = line.find(':');
+		if (colon_pos == std::string::npos)
+			continue;
+
+		std::string name = to_lowercase(trim(line.substr(0, colon_pos)));
+		std::string value = to_lowercase(trim(line.substr(colon_pos + 1)));
+
+		if (name == "content-length")
+		{
+			has_length = true;
+			content_length = std::strtoull(value.c_str(), nullptr, 10);
+		}
+		else if (name == "transfer-encoding")
+		{
+			chunked = value.find("chunked") != std::string::npos;
+		}
+		else if (name == "connection")
+		{
+			upstream_close = value.find("close") != std::string::npos;
+		}
+
+		// Chunked framing is passed through unchanged, so its header goes along with it
+		if (!isHopByHopHeader(name) || (name == "transfer-encoding" && chunked))
+			client_head += line + "\r\n";
+	}
+
+	// No body for HEAD, 204 and 304 (interim 1xx heads were skipped); otherwise without framing the body runs until close
+	bool no_body = request.method == "HEAD" || status_code == 204 || status_code == 304;
+	bool until_close = !no_body && !chunked && !has_length;
+	if (until_close)
+		keep_alive = false;
+
+	client_head += keep_alive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+
+	std::cout << "[PROXY] " << request.method << " " << request.path << " -> " << backend.host << ":" << backend.port
+		<< " status " << status_code << std::endl;
+
+	// Stream: head first, then body bytes as they arrive from the backend
+	bool client_ok = sendToClient(client_head) >= 0;
+	std::string body = buffer.substr(head_end + 4);
+	ChunkedDecoder decoder;
+	unsigned long long body_sent = 0;
+	bool complete = no_body;
+	bool upstream_ok = true;
+	bool unread_bytes = no_body && !body.empty();   // Bytes past the response: the connection is out of sync
+
+	while (!complete)
+	{
+		if (!body.empty())
+		{
+			size_t usable = body.length();
+			if (has_length && !chunked)
+				usable = static_cast<size_t>(std::min<unsigned long long>(usable, content_length - body_sent));
+
+			if (chunked)
+			{
+				complete = decoder.consume(body.data(), usable);
+				usable = decoder.consumed;
+			}
+			else if (has_length)
+			{
+				complete = body_sent + usable >= content_length;
+			}
+			unread_bytes = usable < body.length();
+
+			if (client_ok)
+				client_ok = sendToClient(body.substr(0, usable)) >= 0;
+			body_sent += usable;
+			body.clear();
+
+			if (complete || decoder.malformed)
+				break;
+		}
+
+		if (has_length && !chunked && body_sent >= content_length)
+		{
+			complete = true;
+			break;
+		}
+
+		int received = receiveChunk(upstream_socket, body);
+		if (received <= 0)
+		{
+			// Read-until-close bodies end normally here; anything else was cut short
+			complete = until_close && received == 0;
+			upstream_ok = false;
+			break;
+		}
+	}
+
+	backend.active_requests--;
+
+	if (complete && !decoder.malformed)
+		recordSuccess(backend);
+	else
+		recordFailure(backend, false);
+
+	// Return the upstream connection to the pool only if its framing ended cleanly
+	if (complete && upstream_ok && !until_close && !upstream_close && !decoder.malformed && !unread_bytes)
+		releaseConnection(backend, upstream_socket);
+	else
+		closesocket(upstream_socket);
+
+	// A truncated response leaves the client framing broken, so that connection must close
+	if (!complete || !client_ok || decoder.malformed)
+		keep_alive = false;
+
+	return true;
+}
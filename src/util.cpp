@@ -103,3 +103,42 @@ size_t find_sequence(const std::string& str, const std::string& sequence)
 		
 	return str.find(sequence);
 }
+
+// Length of the valid UTF-8 sequence starting at text[pos], 0 if it is not one
+size_t utf8SequenceLength(std::string_view text, size_t pos)
+{
+	unsigned char lead = static_cast<unsigned char>(text[pos]);
+	if (lead < 0x80)
+		return 1;
+
+	size_t length = lead >= 0xF0 && lead <= 0xF4 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC2 && lead <= 0xDF ? 2 : 0;
+	if (lead >= 0xF5 || length == 0 || pos + length > text.length())
+		return 0;
+
+	for (size_t i = 1; i < length; i++)
+	{
+		if ((static_cast<unsigned char>(text[pos + i]) & 0xC0) != 0x80)
+			return 0;
+	}
+
+	// Overlong forms, UTF-16 surrogates and code points past U+10FFFF
+	unsigned char second = static_cast<unsigned char>(text[pos + 1]);
+	if ((lead == 0xE0 && second < 0xA0) || (lead == 0xED && second >= 0xA0) ||
+		(lead == 0xF0 && second < 0x90) || (lead == 0xF4 && second >= 0x90))
+		return 0;
+	return length;
+}
+
+// Whether the whole string is well-formed UTF-8
+bool isValidUtf8(std::string_view text)
+{
+	size_t pos = 0;
+	while (pos < text.length())
+	{
+		size_t length = utf8SequenceLength(text, pos);
+		if (length == 0)
+			return false;
+		pos += length;
+	}
+	return true;
+}
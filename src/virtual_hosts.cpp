@@ -0,0 +1,118 @@
+#include "virtual_hosts.h"
+#include "util.h"
+#include <iostream>
+#include <algorithm>
+
+// Longest valid DNS name is 253 characters; anything longer goes to the default host
+const size_t MAX_HOST_LENGTH = 255;
+
+static bool lessByName(const std::pair<std::string, VirtualHost*>& entry, std::string_view name)
+{
+	return std::string_view(entry.first) < name;
+}
+
+static VirtualHost* findSorted(const std::vector<std::pair<std::string, VirtualHost*>>& table, std::string_view name)
+{
+	auto it = std::lower_bound(table.begin(), table.end(), name, lessByName);
+	if (it != table.end() && it->first == name)
+		return it->second;
+	return nullptr;
+}
+
+VirtualHostTable::VirtualHostTable(const std::vector<VirtualHostConfig>& hosts, const std::string& default_name)
+{
+	for (const auto& host_config : hosts)
+	{
+		std::unique_ptr<VirtualHost> host(new VirtualHost());
+		host->name = to_lowercase(host_config.host);
+
+		std::cout << "[VHOST] " << host->name << " -> " << (host_config.bundle_file.empty() ? host_config.webroot : host_config.bundle_file) << std::endl;
+		host->file_handler.reset(new FileHandler(host_config.webroot, host_config.bundle_file));
+
+		if (host->name == "*")
+			default_host = host.get();
+		else if (host->name.compare(0, 2, "*.") == 0)
+			wildcard_suffixes.push_back({host->name.substr(1), host.get()});
+		else
+			exact_hosts.push_back({host->name, host.get()});
+
+		all_hosts.push_back(std::move(host));
+	}
+
+	auto byName = [](const std::pair<std::string, VirtualHost*>& a, const std::pair<std::string, VirtualHost*>& b)
+	{
+		return a.first < b.first;
+	};
+	std::sort(exact_hosts.begin(), exact_hosts.end(), byName);
+	std::sort(wildcard_suffixes.begin(), wildcard_suffixes.end(), byName);
+
+	if (!default_name.empty())
+	{
+		std::string name = to_lowercase(default_name);
+		for (const auto& host : all_hosts)
+		{
+			if (host->name == name)
+				default_host = host.get();
+		}
+
+		if (default_host == nullptr || default_host->name != name)
+			std::cout << "[VHOST] default_host '" << default_name << "' is not a configured host" << std::endl;
+	}
+
+	if (default_host == nullptr && !all_hosts.empty())
+		default_host = all_hosts.front().get();
+}
+
+VirtualHost* VirtualHostTable::find(std::string_view host_header) const
+{
+	// Drop the port; an IPv6 literal keeps its brackets ("[::1]:8080" -> "[::1]")
+	size_t end = host_header.length();
+	if (!host_header.empty() && host_header[0] == '[')
+	{
+		size_t bracket = host_header.find(']');
+		if (bracket != std::string_view::npos)
+			end = bracket + 1;
+	}
+	else
+	{
+		end = std::min(end, host_header.find(':'));
+	}
+
+	// "example.com." is the same host as "example.com"
+	if (end > 0 && host_header[end - 1] == '.')
+		end--;
+
+	if (end == 0 || end > MAX_HOST_LENGTH)
+		return default_host;
+
+	// Lowercase into a stack buffer so the lookup never allocates
+	char buffer[MAX_HOST_LENGTH];
+	for (size_t i = 0; i < end; i++)
+	{
+		char c = host_header[i];
+		buffer[i] = (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+	}
+	std::string_view name(buffer, end);
+
+	if (VirtualHost* host = findSorted(exact_hosts, name))
+		return host;
+
+	// Try ".b.example.com", then ".example.com", then ".com": the longest suffix wins
+	for (size_t dot = name.find('.'); dot != std::string_view::npos; dot = name.find('.', dot + 1))
+	{
+		if (VirtualHost* host = findSorted(wildcard_suffixes, name.substr(dot)))
+			return host;
+	}
+
+	return default_host;
+}
+
+void VirtualHostTable::recordResponse(VirtualHost& host, const ResponseData& response)
+{
+	host.metrics.requests++;
+	if (response.status_code >= 500)
+		host.metrics.server_errors++;
+	else if (response.status_code >= 400)
+		host.metrics.client_errors++;
+	host.metrics.body_bytes += responseBody(response).length();
+}
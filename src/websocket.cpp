@@ -0,0 +1,220 @@
+#include "websocket.h"
+#include "util.h"
+#include <cstdint>
+#include <cstring>
+
+static const char WEBSOCKET_GUID[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+static uint32_t rotateLeft(uint32_t value, int bits)
+{
+	return (value << bits) | (value >> (32 - bits));
+}
+
+// SHA-1 digest (FIPS 180-1); only used for the handshake, so it favours brevity over speed
+static void sha1(const std::string& message, unsigned char digest[20])
+{
+	uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+
+	// Pad to a multiple of 64 bytes: 0x80, zeros, then the bit length big-endian
+	std::string data = message;
+	uint64_t bit_length = static_cast<uint64_t>(message.length()) * 8;
+	data += static_cast<char>(0x80);
+	while (data.length() % 64 != 56)
+		data += '\0';
+	for (int i = 7; i >= 0; i--)
+		data += static_cast<char>((bit_length >> (i * 8)) & 0xFF);
+
+	for (size_t chunk = 0; chunk < data.length(); chunk += 64)
+	{
+		uint32_t w[80];
+		for (int i = 0; i < 16; i++)
+		{
+			const unsigned char* p = reinterpret_cast<const unsigned char*>(data.data() + chunk + i * 4);
+			w[i] = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+		}
+		for (int i = 16; i < 80; i++)
+			w[i] = rotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+		uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+		for (int i = 0; i < 80; i++)
+		{
+			uint32_t f, k;
+			if (i < 20) { f = (b & c) | (~b & d); k = 0x5A827999; }
+			else if (i < 40) { f = b ^ c ^ d; k = 0x6ED9EBA1; }
+			else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+			else { f = b ^ c ^ d; k = 0xCA62C1D6; }
+
+			uint32_t temp = rotateLeft(a, 5) + f + e + k + w[i];
+			e = d;
+			d = c;
+			c = rotateLeft(b, 30);
+			b = a;
+			a = temp;
+		}
+
+		h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+	}
+
+	for (int i = 0; i < 5; i++)
+	{
+		digest[i * 4] = static_cast<unsigned char>(h[i] >> 24);
+		digest[i * 4 + 1] = static_cast<unsigned char>(h[i] >> 16);
+		digest[i * 4 + 2] = static_cast<unsigned char>(h[i] >> 8);
+		digest[i * 4 + 3] = static_cast<unsigned char>(h[i]);
+	}
+}
+
+static std::string base64Encode(const unsigned char* data, size_t length)
+{
+	static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+	std::string encoded;
+	encoded.reserve((length + 2) / 3 * 4);
+	for (size_t i = 0; i < length; i += 3)
+	{
+		uint32_t group = uint32_t(data[i]) << 16;
+		if (i + 1 < length)
+			group |= uint32_t(data[i + 1]) << 8;
+		if (i + 2 < length)
+			group |= data[i + 2];
+
+		encoded += alphabet[(group >> 18) & 0x3F];
+		encoded += alphabet[(group >> 12) & 0x3F];
+		encoded += i + 1 < length ? alphabet[(group >> 6) & 0x3F] : '=';
+		encoded += i + 2 < length ? alphabet[group & 0x3F] : '=';
+	}
+	return encoded;
+}
+
+// True if the comma-separated header value contains token (case-insensitive)
+static bool headerHasToken(std::string_view value, const std::string& token)
+{
+	for (const std::string& item : split(std::string(value), ','))
+	{
+		if (to_lowercase(trim(item)) == token)
+			return true;
+	}
+	return false;
+}
+
+bool isWebSocketUpgrade(const RequestData& request)
+{
+	return request.method == "GET" &&
+		to_lowercase(trim(std::string(findHeader(request, "upgrade")))) == "websocket" &&
+		headerHasToken(findHeader(request, "connection"), "upgrade");
+}
+
+std::string webSocketAccept(std::string_view key)
+{
+	unsigned char digest[20];
+	sha1(std::string(key) + WEBSOCKET_GUID, digest);
+	return base64Encode(digest, sizeof(digest));
+}
+
+std::string encodeWebSocketFrame(unsigned char opcode, std::string_view payload)
+{
+	std::string frame;
+	frame.reserve(payload.length() + 10);
+	frame += static_cast<char>(0x80 | opcode);   // FIN, no extensions
+
+	uint64_t length = payload.length();
+	if (length < 126)
+	{
+		frame += static_cast<char>(length);
+	}
+	else if (length <= 0xFFFF)
+	{
+		frame += static_cast<char>(126);
+		frame += static_cast<char>((length >> 8) & 0xFF);
+		frame += static_cast<char>(length & 0xFF);
+	}
+	else
+	{
+		frame += static_cast<char>(127);
+		for (int i = 7; i >= 0; i--)
+			frame += static_cast<char>((length >> (i * 8)) & 0xFF);
+	}
+
+	frame.append(payload.data(), payload.length());
+	return frame;
+}
+
+std::string encodeWebSocketClose(unsigned short status_code)
+{
+	char payload[2] = {static_cast<char>(status_code >> 8), static_cast<char>(status_code & 0xFF)};
+	return encodeWebSocketFrame(WS_CLOSE, std::string_view(payload, sizeof(payload)));
+}
+
+size_t decodeWebSocketFrame(std::string_view buffer, size_t max_payload, WebSocketFrame& frame)
+{
+	if (buffer.length() < 2)
+		return WS_FRAME_INCOMPLETE;
+
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(buffer.data());
+	bool fin = (bytes[0] & 0x80) != 0;
+	unsigned char opcode = bytes[0] & 0x0F;
+	bool masked = (bytes[1] & 0x80) != 0;
+	uint64_t length = bytes[1] & 0x7F;
+
+	// No extensions are negotiated, so reserved bits must be clear; clients must mask
+	if ((bytes[0] & 0x70) != 0 || !masked)
+		return WS_FRAME_ERROR;
+
+	// Opcodes 0x3-0x7 and 0xB-0xF are reserved
+	if (opcode != WS_CONTINUATION && opcode != WS_TEXT && opcode != WS_BINARY &&
+		opcode != WS_CLOSE && opcode != WS_PING && opcode != WS_PONG)
+		return WS_FRAME_ERROR;
+
+	// Control frames are short and never fragmented
+	bool control = (opcode & 0x08) != 0;
+	if (control && (!fin || length > 125))
+		return WS_FRAME_ERROR;
+
+	size_t header_length = 2;
+	if (length == 126 || length == 127)
+	{
+		size_t extra = length == 126 ? 2 : 8;
+		if (buffer.length() < header_length + extra)
+			return WS_FRAME_INCOMPLETE;
+
+		length = 0;
+		for (size_t i = 0; i < extra; i++)
+			length = (length << 8) | bytes[header_length + i];
+		header_length += extra;
+	}
+
+	if (length > max_payload)
+		return WS_FRAME_TOO_BIG;
+
+	size_t frame_length = header_length + 4 + static_cast<size_t>(length);
+	if (buffer.length() < frame_length)
+		return WS_FRAME_INCOMPLETE;
+
+	const unsigned char* mask = bytes + header_length;
+	const unsigned char* payload = mask + 4;
+
+	frame.fin = fin;
+	frame.opcode = opcode;
+	frame.payload.resize(static_cast<size_t>(length));
+	for (size_t i = 0; i < length; i++)
+		frame.payload[i] = static_cast<char>(payload[i] ^ mask[i % 4]);
+
+	return frame_length;
+}
+
+unsigned short webSocketPayloadError(unsigned char opcode, std::string_view payload)
+{
+	if (opcode == WS_CLOSE)
+	{
+		// A one-byte body cannot hold the status code
+		if (payload.length() == 1)
+			return WS_CLOSE_PROTOCOL_ERROR;
+		if (payload.length() > 2 && !isValidUtf8(payload.substr(2)))
+			return WS_CLOSE_INVALID_DATA;
+		return 0;
+	}
+
+	if (opcode == WS_TEXT && !isValidUtf8(payload))
+		return WS_CLOSE_INVALID_DATA;
+	return 0;
+}
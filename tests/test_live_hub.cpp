@@ -0,0 +1,144 @@
+// Live hub: channel paths, SSE encoding, shared fan-out and the slow-consumer policies
+#undef NDEBUG
+#include <cassert>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "live_hub.h"
+#include "websocket.h"
+
+typedef std::vector<std::shared_ptr<const std::string>> Messages;
+
+// A subscriber with its own wake event, released at the end of the test
+struct TestSubscriber : LiveSubscriber {
+	explicit TestSubscriber(LiveProtocol stream_protocol)
+	{
+		protocol = stream_protocol;
+		wake_event = WSACreateEvent();
+	}
+
+	~TestSubscriber()
+	{
+		WSACloseEvent(wake_event);
+	}
+};
+
+static void testMatchChannel()
+{
+	LiveHub hub("/live/", 1024, SlowConsumerPolicy::Drop);
+	std::string channel;
+	assert(hub.matchChannel("/live/news", channel) && channel == "news");
+	assert(hub.matchChannel("/live/news?last=5", channel) && channel == "news");
+	assert(!hub.matchChannel("/live/", channel));
+	assert(!hub.matchChannel("/live/?x", channel));
+	assert(!hub.matchChannel("/static/news", channel));
+}
+
+static void testEventStream()
+{
+	// One data line per message line; CRLF endings lose their CR
+	assert(encodeEventStream("hello") == "data: hello\n\n");
+	assert(encodeEventStream("a\r\nb\nc") == "data: a\ndata: b\ndata: c\n\n");
+	assert(encodeEventStream("") == "data: \n\n");
+}
+
+static void testFanOut()
+{
+	LiveHub hub("/live/", 1024, SlowConsumerPolicy::Drop);
+	TestSubscriber first(LiveProtocol::EventStream);
+	TestSubscriber second(LiveProtocol::EventStream);
+	TestSubscriber socket(LiveProtocol::WebSocket);
+	hub.subscribe("news", &first);
+	hub.subscribe("news", &second);
+	hub.subscribe("news", &socket);
+
+	assert(hub.publish("sports", "nobody listens") == 0);
+	assert(hub.publish("news", "update") == 3);
+
+	// Encoded once per protocol and shared, never copied per subscriber
+	Messages first_taken, second_taken, socket_taken;
+	assert(LiveHub::takePending(first, first_taken));
+	assert(LiveHub::takePending(second, second_taken));
+	assert(LiveHub::takePending(socket, socket_taken));
+	assert(first_taken.size() == 1 && second_taken.size() == 1 && socket_taken.size() == 1);
+	assert(first_taken[0].get() == second_taken[0].get());
+	assert(*first_taken[0] == "data: update\n\n");
+	assert(*socket_taken[0] == encodeWebSocketFrame(WS_TEXT, "update"));
+
+	// Taking empties the queue
+	Messages again;
+	assert(LiveHub::takePending(first, again) && again.empty() && first.pending_bytes == 0);
+
+	hub.publish("news", "raw", true);
+	assert(LiveHub::takePending(socket, socket_taken));
+	assert(*socket_taken[0] == encodeWebSocketFrame(WS_BINARY, "raw"));
+
+	// Unsubscribed streams get nothing more
+	hub.unsubscribe("news", &first);
+	hub.unsubscribe("news", &second);
+	hub.unsubscribe("news", &socket);
+	assert(hub.publish("news", "late") == 0);
+}
+
+static void testSlowConsumers()
+{
+	// "data: 0123456789\n\n" is 18 bytes, so two fit in the 40-byte limit and a third does not
+	std::string message = "0123456789";
+
+	LiveHub dropping("/live/", 40, SlowConsumerPolicy::Drop);
+	TestSubscriber slow(LiveProtocol::EventStream);
+	dropping.subscribe("news", &slow);
+	assert(dropping.publish("news", message) == 1);
+	assert(dropping.publish("news", message) == 1);
+	assert(dropping.publish("news", message) == 0);
+	assert(slow.dropped == 1 && !slow.closing);
+
+	Messages taken;
+	assert(LiveHub::takePending(slow, taken) && taken.size() == 2);
+	assert(dropping.publish("news", message) == 1);
+	dropping.unsubscribe("news", &slow);
+
+	LiveHub disconnecting("/live/", 40, SlowConsumerPolicy::Disconnect);
+	TestSubscriber stalled(LiveProtocol::EventStream);
+	disconnecting.subscribe("news", &stalled);
+	disconnecting.publish("news", message);
+	disconnecting.publish("news", message);
+	assert(disconnecting.publish("news", message) == 0);
+
+	// The backlog is abandoned and the connection told to close
+	assert(stalled.closing && stalled.pending.empty() && stalled.pending_bytes == 0);
+	assert(!LiveHub::takePending(stalled, taken));
+	disconnecting.unsubscribe("news", &stalled);
+}
+
+static void testCloseAll()
+{
+	LiveHub hub("/live/", 1024, SlowConsumerPolicy::Drop);
+	TestSubscriber open(LiveProtocol::WebSocket);
+	hub.subscribe("news", &open);
+	hub.closeAll();
+
+	Messages taken;
+	assert(!LiveHub::takePending(open, taken));
+
+	// Subscribing after shutdown closes at once
+	TestSubscriber late(LiveProtocol::EventStream);
+	hub.subscribe("news", &late);
+	assert(late.closing);
+
+	hub.unsubscribe("news", &open);
+	hub.unsubscribe("news", &late);
+}
+
+int main()
+{
+	testMatchChannel();
+	testEventStream();
+	testFanOut();
+	testSlowConsumers();
+	testCloseAll();
+
+	std::cout << "[TEST] live_hub: all passed" << std::endl;
+	return 0;
+}
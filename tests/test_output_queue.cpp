@@ -0,0 +1,107 @@
+// Output queue: responses become segments, small pieces share pooled blocks, bodies are not copied
+#undef NDEBUG
+#include <cassert>
+#include <iostream>
+#include <memory>
+#include <string>
+#include "server.h"
+#include "connection_handler.h"
+#include "response_builder.h"
+
+// Everything queued, in order, as the client would receive it
+static std::string queuedText(const OutputQueue& queue)
+{
+	std::string text;
+	for (const OutputSegment& segment : queue.segments)
+		text.append(segment.data, segment.length);
+	return text;
+}
+
+static void testCopiesCoalesce()
+{
+	OutputQueue queue;
+	queueCopy(queue, "HTTP/1.1 ", 9);
+	queueCopy(queue, "200 OK\r\n", 8);
+	queueCopy(queue, "", 0);
+
+	// Consecutive small copies land in one block and go out as one buffer
+	assert(queue.segments.size() == 1);
+	assert(queue.blocks.size() == 1);
+	assert(queue.queued_bytes == 17);
+	assert(queuedText(queue) == "HTTP/1.1 200 OK\r\n");
+
+	releaseOutputBlocks(queue);
+	assert(queue.blocks.empty() && queue.block_used == 0);
+}
+
+static void testSlicesAreNotCopied()
+{
+	OutputQueue queue;
+	auto body = std::make_shared<const std::string>(10000, 'b');
+	queueCopy(queue, "head", 4);
+	queueSlice(queue, body, body->data(), body->length());
+	queueCopy(queue, "tail", 4);
+
+	// The slice points into its owner; the copy after it cannot merge across it
+	assert(queue.segments.size() == 3);
+	assert(queue.segments[1].data == body->data());
+	assert(queue.segments[1].owner.get() == body.get());
+	assert(queue.queued_bytes == 10008);
+	assert(queuedText(queue) == "head" + *body + "tail");
+}
+
+static void testLargeCopy()
+{
+	// Larger than a pooled block: it gets storage of its own
+	OutputQueue queue;
+	std::string large(BUFFER_SIZE_CLASSES[0] + 1, 'x');
+	queueCopy(queue, large.data(), large.length());
+	assert(queue.blocks.empty());
+	assert(queue.segments.size() == 1 && queue.segments[0].owner);
+	assert(queuedText(queue) == large);
+
+	// Moving a string in keeps its bytes without a copy
+	std::string moved(50000, 'm');
+	queueData(queue, std::move(moved));
+	assert(queue.segments.size() == 2);
+	assert(queue.queued_bytes == large.length() + 50000);
+}
+
+static void testQueueResponse()
+{
+	Connection connection{};
+	ResponseData response = generateErrorResponse(404, "Not Found");
+	std::string expected = serializeResponse(response);
+	queueResponse(connection, response);
+	assert(queuedText(connection.output) == expected);
+	assert(connection.output.queued_bytes == expected.length());
+
+	// An external body is queued as a slice of its owner's memory
+	auto owner = std::make_shared<const std::string>(20000, 'e');
+	ResponseData file;
+	file.status_code = 200;
+	file.reason_phrase = "OK";
+	setHeader(file, "Content-Type", "text/plain");
+	file.body_owner = owner;
+	file.external_body = *owner;
+	size_t before = connection.output.segments.size();
+	queueResponse(connection, file);
+	assert(connection.output.segments.back().data == owner->data());
+	assert(connection.output.segments.size() > before);
+
+	// Pipelined responses stay in order
+	std::string text = queuedText(connection.output);
+	assert(text.compare(0, expected.length(), expected) == 0);
+	assert(text.compare(text.length() - owner->length(), owner->length(), *owner) == 0);
+}
+
+int main()
+{
+	testCopiesCoalesce();
+	testSlicesAreNotCopied();
+	testLargeCopy();
+	testQueueResponse();
+
+	std::cout << "[TEST] output_queue: all passed" << std::endl;
+	return 0;
+}
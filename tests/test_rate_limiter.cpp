@@ -0,0 +1,149 @@
+// GCRA buckets: bursts, refill, byte debt and client keys
+#undef NDEBUG
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include "rate_limiter.h"
+
+const uint32_t CLIENT_A = 0x0A000001;   // 10.0.0.1
+const uint32_t CLIENT_B = 0x0A000002;   // 10.0.0.2, same /24
+const uint32_t CLIENT_C = 0x0A000101;   // 10.0.1.1
+
+static void testRequestBurst()
+{
+	RateLimitOptions options;
+	options.requests_per_second = 10;
+	options.request_burst = 5;
+	RateLimiter limiter(options);
+
+	// The test runs in far less than the 100ms one token takes to refill
+	for (int i = 0; i < 5; i++)
+		assert(limiter.admitRequest(CLIENT_A));
+	assert(!limiter.admitRequest(CLIENT_A));
+
+	// Other clients have their own bucket
+	assert(limiter.admitRequest(CLIENT_B));
+
+	// A refused request is not charged, so the bucket refills on time
+	std::this_thread::sleep_for(std::chrono::milliseconds(250));
+	assert(limiter.admitRequest(CLIENT_A));
+	assert(limiter.admitRequest(CLIENT_A));
+}
+
+static void testDefaultBurst()
+{
+	// Burst 0 means one second's worth
+	RateLimitOptions options;
+	options.requests_per_second = 20;
+	RateLimiter limiter(options);
+
+	int admitted = 0;
+	while (admitted < 100 && limiter.admitRequest(CLIENT_A))
+		admitted++;
+	assert(admitted == 20);
+}
+
+static void testByteDebt()
+{
+	RateLimitOptions options;
+	options.bytes_per_second = 1000;
+	options.byte_burst = 1000;
+	RateLimiter limiter(options);
+
+	// Within the burst the client stays admitted; the request limit is off
+	limiter.chargeBytes(CLIENT_A, 500);
+	for (int i = 0; i < 100; i++)
+		assert(limiter.admitRequest(CLIENT_A));
+
+	// A response five seconds' worth over puts the client in debt until it drains
+	limiter.chargeBytes(CLIENT_A, 5000);
+	assert(!limiter.admitRequest(CLIENT_A));
+	assert(limiter.admitRequest(CLIENT_B));
+}
+
+static void testPrefix()
+{
+	RateLimitOptions options;
+	options.requests_per_second = 10;
+	options.request_burst = 2;
+	options.prefix_bits = 24;
+	RateLimiter limiter(options);
+
+	// A and B share a /24 and so one bucket; C does not
+	assert(limiter.admitRequest(CLIENT_A));
+	assert(limiter.admitRequest(CLIENT_B));
+	assert(!limiter.admitRequest(CLIENT_A));
+	assert(limiter.admitRequest(CLIENT_C));
+}
+
+static void testFullTable()
+{
+	RateLimitOptions options;
+	options.requests_per_second = 10;
+	options.request_burst = 1;
+	options.table_size = 8;
+	RateLimiter limiter(options);
+
+	// More clients than slots: each new one takes over a slot and starts with a full bucket
+	for (uint32_t client = 1; client <= 64; client++)
+		assert(limiter.admitRequest(client));
+}
+
+static void testConcurrentFlood()
+{
+	// One shard of 8 slots, one request per client until its bucket refills ten seconds later
+	RateLimitOptions options;
+	options.requests_per_second = 0.1;
+	options.request_burst = 1;
+	options.table_size = 8;
+	RateLimiter limiter(options);
+
+	const uint32_t RESIDENTS = 8;
+	for (uint32_t client = 1; client <= RESIDENTS; client++)
+		assert(limiter.admitRequest(client));
+
+	// New addresses flood the full shard while the residents keep asking. The residents' slots
+	// were just claimed, so none may be taken over and have its spent bucket reset.
+	std::atomic<int> resident_admits{0};
+	std::vector<std::thread> threads;
+	auto start = std::chrono::steady_clock::now();
+	for (int t = 0; t < 4; t++)
+	{
+		threads.emplace_back([&limiter, t]() {
+			for (uint32_t i = 0; i < 2000; i++)
+				limiter.admitRequest(0x0B000000 + static_cast<uint32_t>(t) * 2000 + i);
+		});
+		threads.emplace_back([&limiter, &resident_admits]() {
+			for (int i = 0; i < 2000; i++)
+			{
+				for (uint32_t client = 1; client <= RESIDENTS; client++)
+				{
+					if (limiter.admitRequest(client))
+						resident_admits++;
+				}
+			}
+		});
+	}
+	for (std::thread& thread : threads)
+		thread.join();
+
+	// Past the one-second claim grace the residents may be taken over, as designed
+	if (std::chrono::steady_clock::now() - start < std::chrono::seconds(1))
+		assert(resident_admits == 0);
+}
+
+int main()
+{
+	testRequestBurst();
+	testDefaultBurst();
+	testByteDebt();
+	testPrefix();
+	testFullTable();
+	testConcurrentFlood();
+
+	std::cout << "[TEST] rate_limiter: all passed" << std::endl;
+	return 0;
+}
@@ -0,0 +1,92 @@
+// Request framing: where findRequestEnd() says the first request in a buffer ends
+#undef NDEBUG
+#include <cassert>
+#include <iostream>
+#include <string>
+#include "request_parser.h"
+
+static void testHeadOnly()
+{
+	std::string request = "GET / HTTP/1.1\r\nHost: a\r\n\r\n";
+	assert(findRequestEnd(request) == request.length());
+	assert(findHeadEnd(request) == request.length());
+
+	// No blank line yet
+	assert(findRequestEnd("GET / HTTP/1.1\r\nHost: a\r\n") == std::string::npos);
+	assert(findHeadEnd("GET / HTTP/1.1\r\nHost: a\r\n") == std::string::npos);
+}
+
+static void testContentLength()
+{
+	std::string head = "POST /x HTTP/1.1\r\nContent-Length: 5\r\n\r\n";
+	assert(findRequestEnd(head) == std::string::npos);
+	assert(findRequestEnd(head + "abc") == std::string::npos);
+	assert(findRequestEnd(head + "abcde") == head.length() + 5);
+	assert(findHeadEnd(head + "abc") == head.length());
+
+	// Header names are case-insensitive and the value may be padded
+	std::string mixed = "POST /x HTTP/1.1\r\ncontent-LENGTH:   3  \r\n\r\nabc";
+	assert(findRequestEnd(mixed) == mixed.length());
+
+	// Repeating the same length is allowed
+	std::string repeated = "POST /x HTTP/1.1\r\nContent-Length: 2\r\nContent-Length: 2\r\n\r\nab";
+	assert(findRequestEnd(repeated) == repeated.length());
+
+	// An explicit zero, and header lines without a colon, frame like no body
+	std::string zero = "POST /x HTTP/1.1\r\nContent-Length: 0\r\nX-Broken\r\n\r\n";
+	assert(findRequestEnd(zero + "GET") == zero.length());
+}
+
+static void testBadLength()
+{
+	const char* values[] = {"", "+5", "-1", "5,5", "0x10", "1 2", "1234567890123456789"};
+	for (const char* value : values)
+	{
+		std::string request = std::string("POST /x HTTP/1.1\r\nContent-Length: ") + value + "\r\n\r\n";
+		assert(findRequestEnd(request) == REQUEST_BAD_LENGTH);
+	}
+
+	std::string conflicting = "POST /x HTTP/1.1\r\nContent-Length: 2\r\nContent-Length: 3\r\n\r\nabc";
+	assert(findRequestEnd(conflicting) == REQUEST_BAD_LENGTH);
+}
+
+static void testTransferEncoding()
+{
+	std::string chunked = "POST /x HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nhello\r\n0\r\n\r\n";
+	assert(findRequestEnd(chunked) == REQUEST_UNSUPPORTED_ENCODING);
+
+	// Even alongside a Content-Length, which it would override
+	std::string both = "POST /x HTTP/1.1\r\nContent-Length: 3\r\ntransfer-encoding: identity\r\n\r\nabc";
+	assert(findRequestEnd(both) == REQUEST_UNSUPPORTED_ENCODING);
+}
+
+static void testPipelining()
+{
+	std::string first = "POST /a HTTP/1.1\r\nContent-Length: 4\r\n\r\nGET ";
+	std::string second = "GET /b HTTP/1.1\r\nHost: a\r\n\r\n";
+	std::string third = "GET /c HTTP/1.1\r\n";
+	std::string buffer = first + second + third;
+
+	// The body is not mistaken for the next request line, and each request ends where it should
+	size_t end = findRequestEnd(buffer);
+	assert(end == first.length());
+	buffer.erase(0, end);
+
+	end = findRequestEnd(buffer);
+	assert(end == second.length());
+	buffer.erase(0, end);
+
+	assert(findRequestEnd(buffer) == std::string::npos);
+}
+
+int main()
+{
+	testHeadOnly();
+	testContentLength();
+	testBadLength();
+	testTransferEncoding();
+	testPipelining();
+
+	std::cout << "[TEST] request_parser: all passed" << std::endl;
+	return 0;
+}
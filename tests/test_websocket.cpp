@@ -0,0 +1,144 @@
+// WebSocket handshake key and client frame decoding
+#undef NDEBUG
+#include <cassert>
+#include <iostream>
+#include <string>
+#include "websocket.h"
+
+// Masked client frame as a browser would send it
+static std::string clientFrame(unsigned char first_byte, const std::string& payload)
+{
+	const unsigned char mask[4] = {0x37, 0xFA, 0x21, 0x3D};
+	std::string frame(1, static_cast<char>(first_byte));
+
+	if (payload.length() < 126)
+	{
+		frame += static_cast<char>(0x80 | payload.length());
+	}
+	else if (payload.length() <= 0xFFFF)
+	{
+		frame += static_cast<char>(0x80 | 126);
+		frame += static_cast<char>(payload.length() >> 8);
+		frame += static_cast<char>(payload.length() & 0xFF);
+	}
+	else
+	{
+		frame += static_cast<char>(0x80 | 127);
+		for (int shift = 56; shift >= 0; shift -= 8)
+			frame += static_cast<char>((static_cast<unsigned long long>(payload.length()) >> shift) & 0xFF);
+	}
+
+	frame.append(reinterpret_cast<const char*>(mask), 4);
+	for (size_t i = 0; i < payload.length(); i++)
+		frame += static_cast<char>(payload[i] ^ mask[i % 4]);
+	return frame;
+}
+
+static void testAcceptKey()
+{
+	// Example from RFC 6455 section 1.3
+	assert(webSocketAccept("dGhlIHNhbXBsZSBub25jZQ==") == "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+}
+
+static void testDecode()
+{
+	WebSocketFrame frame;
+
+	// Masked "Hello" from RFC 6455 section 5.7
+	const unsigned char hello[] = {0x81, 0x85, 0x37, 0xFA, 0x21, 0x3D, 0x7F, 0x9F, 0x4D, 0x51, 0x58};
+	std::string buffer(reinterpret_cast<const char*>(hello), sizeof(hello));
+	assert(decodeWebSocketFrame(buffer, 1024, frame) == sizeof(hello));
+	assert(frame.fin && frame.opcode == WS_TEXT && frame.payload == "Hello");
+
+	// A second frame after the first is left for the next call
+	buffer += clientFrame(0x80 | WS_BINARY, "xy");
+	assert(decodeWebSocketFrame(buffer, 1024, frame) == sizeof(hello));
+
+	// 16-bit and 64-bit lengths
+	std::string medium(300, 'm');
+	std::string encoded = clientFrame(0x80 | WS_BINARY, medium);
+	assert(decodeWebSocketFrame(encoded, 1024, frame) == encoded.length());
+	assert(frame.payload == medium);
+
+	std::string large(70000, 'l');
+	encoded = clientFrame(0x80 | WS_BINARY, large);
+	assert(decodeWebSocketFrame(encoded, 100000, frame) == encoded.length());
+	assert(frame.payload == large);
+
+	// Fragments keep their fin bit and continuation opcode
+	encoded = clientFrame(WS_CONTINUATION, "part");
+	assert(decodeWebSocketFrame(encoded, 1024, frame) == encoded.length());
+	assert(!frame.fin && frame.opcode == WS_CONTINUATION);
+}
+
+static void testIncomplete()
+{
+	WebSocketFrame frame;
+	std::string encoded = clientFrame(0x80 | WS_TEXT, std::string(300, 'a'));
+
+	// Every proper prefix, including one cut inside the extended length or the mask
+	for (size_t length = 0; length < encoded.length(); length++)
+		assert(decodeWebSocketFrame(std::string_view(encoded).substr(0, length), 1024, frame) == WS_FRAME_INCOMPLETE);
+}
+
+static void testErrors()
+{
+	WebSocketFrame frame;
+
+	// Unmasked client frame
+	const unsigned char unmasked[] = {0x81, 0x02, 'h', 'i'};
+	assert(decodeWebSocketFrame(std::string_view(reinterpret_cast<const char*>(unmasked), sizeof(unmasked)), 1024, frame) == WS_FRAME_ERROR);
+
+	// Reserved bits without a negotiated extension
+	assert(decodeWebSocketFrame(clientFrame(0xC0 | WS_TEXT, "hi"), 1024, frame) == WS_FRAME_ERROR);
+
+	// Every reserved opcode, data (0x3-0x7) and control (0xB-0xF)
+	for (unsigned char opcode = 0x3; opcode <= 0xF; opcode++)
+	{
+		if (opcode >= WS_CLOSE && opcode <= WS_PONG)
+			continue;
+		assert(decodeWebSocketFrame(clientFrame(0x80 | opcode, ""), 1024, frame) == WS_FRAME_ERROR);
+	}
+
+	// Control frames must be final and at most 125 bytes
+	assert(decodeWebSocketFrame(clientFrame(WS_PING, "x"), 1024, frame) == WS_FRAME_ERROR);
+	assert(decodeWebSocketFrame(clientFrame(0x80 | WS_PING, std::string(126, 'p')), 1024, frame) == WS_FRAME_ERROR);
+	assert(decodeWebSocketFrame(clientFrame(0x80 | WS_PING, std::string(125, 'p')), 1024, frame) != WS_FRAME_ERROR);
+
+	// Over the payload limit, reported from the header alone
+	std::string encoded = clientFrame(0x80 | WS_BINARY, std::string(2000, 'b'));
+	assert(decodeWebSocketFrame(std::string_view(encoded).substr(0, 8), 1024, frame) == WS_FRAME_TOO_BIG);
+	assert(decodeWebSocketFrame(encoded, 2000, frame) == encoded.length());
+}
+
+static void testPayloadChecks()
+{
+	// Text must be well-formed UTF-8; binary is anything
+	assert(webSocketPayloadError(WS_TEXT, "plain") == 0);
+	assert(webSocketPayloadError(WS_TEXT, "gr\xC3\xBC\xC3\x9F \xE2\x82\xAC \xF0\x9F\x98\x80") == 0);
+	assert(webSocketPayloadError(WS_TEXT, "\xFF") == WS_CLOSE_INVALID_DATA);
+	assert(webSocketPayloadError(WS_TEXT, "\xC0\xAF") == WS_CLOSE_INVALID_DATA);          // Overlong '/'
+	assert(webSocketPayloadError(WS_TEXT, "\xED\xA0\x80") == WS_CLOSE_INVALID_DATA);     // Surrogate
+	assert(webSocketPayloadError(WS_TEXT, "\xF4\x90\x80\x80") == WS_CLOSE_INVALID_DATA); // Past U+10FFFF
+	assert(webSocketPayloadError(WS_TEXT, "\xE2\x82") == WS_CLOSE_INVALID_DATA);          // Cut short
+	assert(webSocketPayloadError(WS_BINARY, "\xFF\xFE") == 0);
+
+	// Close bodies: empty, or a status code with an optional UTF-8 reason
+	assert(webSocketPayloadError(WS_CLOSE, "") == 0);
+	assert(webSocketPayloadError(WS_CLOSE, std::string("\x03\xE8", 2)) == 0);
+	assert(webSocketPayloadError(WS_CLOSE, "\x03\xE8" "bye") == 0);
+	assert(webSocketPayloadError(WS_CLOSE, "\x03") == WS_CLOSE_PROTOCOL_ERROR);
+	assert(webSocketPayloadError(WS_CLOSE, "\x03\xE8\xFF") == WS_CLOSE_INVALID_DATA);
+}
+
+int main()
+{
+	testAcceptKey();
+	testDecode();
+	testIncomplete();
+	testErrors();
+	testPayloadChecks();
+
+	std::cout << "[TEST] websocket: all passed" << std::endl;
+	return 0;
+}
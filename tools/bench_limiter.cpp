@@ -0,0 +1,71 @@
+// http_bench_limiter - time RateLimiter::admitRequest() in a tight loop
+//
+// Limits are set high enough that every request is admitted, so each call does the full
+// lookup and compare-and-swap. The steady_clock read is timed on its own too, since it is
+// part of every call and its cost differs a lot between machines.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include "rate_limiter.h"
+
+const int CALLS_PER_THREAD = 5000000;
+const uint32_t CLIENTS_PER_THREAD = 1024;   // Distinct addresses each thread cycles through
+
+static double nanosecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double timeClockRead()
+{
+	uint64_t sum = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < CALLS_PER_THREAD; i++)
+		sum += static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()) & 1;
+	double total = nanosecondsSince(start);
+
+	// Keeps the loop from being optimized away
+	if (sum == UINT64_MAX)
+		std::cout << sum;
+	return total / CALLS_PER_THREAD;
+}
+
+static double timeAdmit(RateLimiter& limiter, int thread_count)
+{
+	std::vector<std::thread> threads;
+	auto start = std::chrono::steady_clock::now();
+	for (int t = 0; t < thread_count; t++)
+	{
+		threads.emplace_back([&limiter, t]() {
+			uint32_t base = 0x0A000000 + static_cast<uint32_t>(t) * CLIENTS_PER_THREAD;
+			for (int i = 0; i < CALLS_PER_THREAD; i++)
+				limiter.admitRequest(base + (static_cast<uint32_t>(i) % CLIENTS_PER_THREAD));
+		});
+	}
+	for (std::thread& thread : threads)
+		thread.join();
+
+	// Wall time per call on each thread
+	return nanosecondsSince(start) / CALLS_PER_THREAD;
+}
+
+int main(int argc, char* argv[])
+{
+	int max_threads = argc > 1 ? std::stoi(argv[1]) : static_cast<int>(std::thread::hardware_concurrency());
+	if (max_threads < 1)
+		max_threads = 1;
+
+	RateLimitOptions options;
+	options.requests_per_second = 1e9;
+	options.bytes_per_second = 1e12;
+	RateLimiter limiter(options);
+
+	std::cout << "[BENCH] steady_clock read: " << timeClockRead() << " ns" << std::endl;
+	for (int threads = 1; threads <= max_threads; threads *= 2)
+		std::cout << "[BENCH] admitRequest, " << threads << " thread(s): " << timeAdmit(limiter, threads) << " ns per call" << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,171 @@
+// http_load - connection-per-request load against a running server
+//
+// Each request opens a new TCP connection, sends "Connection: close" and reads until the
+// server closes, so every request goes through accept(). Two modes:
+//   steady: N clients loop for a fixed time; reports requests/s and latency percentiles
+//   burst:  N connections are opened at once; reports how long until all were answered,
+//           which is where a short listen backlog shows up (dropped SYNs wait on retransmits)
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <algorithm>
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include "server.h"
+
+struct LoadOptions {
+	std::string host = "127.0.0.1";
+	int port = 8080;
+	std::string path = "/index.html";
+	int clients = 8;         // Concurrent clients in steady mode
+	double seconds = 3.0;
+	int burst = 0;           // Connections opened at once; 0 = steady mode
+};
+
+// One request on a fresh connection; latency in ms, false if nothing came back
+static bool runRequest(const LoadOptions& options, const std::string& request, double& latency_ms)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	SOCKET sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (sock == INVALID_SOCKET)
+		return false;
+
+	sockaddr_in addr = {};
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(options.port);
+	inet_pton(AF_INET, options.host.c_str(), &addr.sin_addr);
+
+	if (connect(sock, (const sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR || sendData(sock, request) < 0)
+	{
+		closesocket(sock);
+		return false;
+	}
+
+	std::string response;
+	while (receiveChunk(sock, response) > 0)
+	{
+	}
+	closesocket(sock);
+
+	latency_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return response.compare(0, 5, "HTTP/") == 0;
+}
+
+static void printLatencies(std::vector<double>& latencies_ms)
+{
+	if (latencies_ms.empty())
+		return;
+
+	std::sort(latencies_ms.begin(), latencies_ms.end());
+	auto percentile = [&](double p)
+	{
+		return latencies_ms[static_cast<size_t>(p * (latencies_ms.size() - 1))];
+	};
+	std::cout << "[LOAD] latency ms: p50=" << percentile(0.50) << " p99=" << percentile(0.99)
+		<< " max=" << latencies_ms.back() << std::endl;
+}
+
+static void printUsage()
+{
+	std::cout << "Usage: http_load [options]" << std::endl;
+	std::cout << "  --target HOST:PORT server to load (default: 127.0.0.1:8080)" << std::endl;
+	std::cout << "  --path PATH        requested path (default: /index.html)" << std::endl;
+	std::cout << "  --clients N        concurrent clients in steady mode (default: 8)" << std::endl;
+	std::cout << "  --seconds S        steady mode duration (default: 3)" << std::endl;
+	std::cout << "  --burst N          open N connections at once instead" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	LoadOptions options;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--path" && i + 1 < argc)
+			options.path = argv[++i];
+		else if (arg == "--clients" && i + 1 < argc)
+			options.clients = std::max(1, std::stoi(argv[++i]));
+		else if (arg == "--seconds" && i + 1 < argc)
+			options.seconds = std::stod(argv[++i]);
+		else if (arg == "--burst" && i + 1 < argc)
+			options.burst = std::stoi(argv[++i]);
+		else if (arg == "--target" && i + 1 < argc)
+		{
+			std::string target = argv[++i];
+			size_t colon_pos = target.find(':');
+			options.host = target.substr(0, colon_pos);
+			options.port = colon_pos == std::string::npos ? 8080 : std::stoi(target.substr(colon_pos + 1));
+		}
+		else
+		{
+			printUsage();
+			return 1;
+		}
+	}
+
+	WSADATA wsaData;
+	WSAStartup(MAKEWORD(2, 2), &wsaData);
+
+	std::string request = "GET " + options.path + " HTTP/1.1\r\nHost: " + options.host + "\r\nConnection: close\r\n\r\n";
+	std::vector<double> latencies_ms;
+	std::mutex latencies_mutex;
+	std::atomic<long> completed{0};
+	std::atomic<long> failed{0};
+	std::atomic<bool> stop{false};
+	std::vector<std::thread> threads;
+
+	auto start = std::chrono::steady_clock::now();
+	int thread_count = options.burst > 0 ? options.burst : options.clients;
+	for (int i = 0; i < thread_count; i++)
+	{
+		threads.emplace_back([&]() {
+			std::vector<double> local;
+			do
+			{
+				double latency_ms = 0;
+				if (runRequest(options, request, latency_ms))
+				{
+					completed++;
+					local.push_back(latency_ms);
+				}
+				else
+				{
+					failed++;
+				}
+			} while (options.burst == 0 && !stop);
+
+			std::lock_guard<std::mutex> lock(latencies_mutex);
+			latencies_ms.insert(latencies_ms.end(), local.begin(), local.end());
+		});
+	}
+
+	if (options.burst == 0)
+	{
+		std::this_thread::sleep_for(std::chrono::duration<double>(options.seconds));
+		stop = true;
+	}
+	for (std::thread& thread : threads)
+		thread.join();
+	double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	if (options.burst > 0)
+	{
+		std::cout << "[LOAD] burst of " << options.burst << ": " << completed << " answered, " << failed
+			<< " failed, all done in " << elapsed_ms << " ms" << std::endl;
+	}
+	else
+	{
+		std::cout << "[LOAD] " << options.clients << " clients: " << completed * 1000.0 / elapsed_ms << " req/s, "
+			<< failed << " failed" << std::endl;
+	}
+	printLatencies(latencies_ms);
+
+	WSACleanup();
+	return failed == 0 ? 0 : 2;
+}
@@ -0,0 +1,189 @@
+// http_pack - pack a webroot into a single read-only asset bundle
+//
+// Usage: http_pack <webroot> <output.bundle>
+//
+// Every file found by the webroot index becomes one entry with a precomputed response
+// head and ETag. If "<file>.gz" exists next to a file, it is stored as that entry's
+// precompressed variant and served to clients that accept gzip, under its own ETag.
+// A file that cannot be read fails the whole pack.
+// The server maps the result with the `bundle` config setting (see asset_bundle.h).
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdio>
+#include <cstring>
+#include "asset_bundle.h"
+#include "path_index.h"
+
+// False if the file cannot be opened or read completely
+static bool readWholeFile(const std::string& path, std::string& contents)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+		return false;
+
+	std::streamsize size = file.tellg();
+	if (size < 0)
+		return false;
+
+	contents.assign(static_cast<size_t>(size), '\0');
+	file.seekg(0);
+	return file.read(&contents[0], size) && file.gcount() == size;
+}
+
+// Strong ETag from a 64-bit FNV-1a hash of the content
+static std::string makeEtag(const std::string& content)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (unsigned char c : content)
+	{
+		hash ^= c;
+		hash *= 1099511628211ull;
+	}
+
+	char buffer[24];
+	snprintf(buffer, sizeof(buffer), "\"%016llx\"", static_cast<unsigned long long>(hash));
+	return buffer;
+}
+
+// Status line and headers for one variant, without the terminating blank line
+static std::string makeHead(const FileEntry& entry, size_t length, const std::string& etag, bool gzip, bool has_variant)
+{
+	std::string head = "HTTP/1.1 200 OK\r\n";
+	head += "Content-Type: " + entry.mime_type + "\r\n";
+	head += "Content-Length: " + std::to_string(length) + "\r\n";
+	head += "ETag: " + etag + "\r\n";
+	if (gzip)
+		head += "Content-Encoding: gzip\r\n";
+	if (has_variant)
+		head += "Vary: Accept-Encoding\r\n";
+	head += "Server: SimpleHTTPServer/1.0\r\n";
+	return head;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc != 3)
+	{
+		std::cout << "Usage: http_pack <webroot> <output.bundle>" << std::endl;
+		return 1;
+	}
+
+	std::string webroot = argv[1];
+	std::string output_path = argv[2];
+
+	PathIndex* index = buildPathIndex(webroot);
+
+	// Sorted by URL path so the server can binary search the table in place.
+	// A foo.gz beside foo is stored only as foo's gzip variant, not as an asset of its own.
+	std::map<std::string, const FileEntry*> sorted;
+	for (const auto& item : index->entries)
+	{
+		const std::string& url_path = item.first;
+		bool is_variant = url_path.size() > 3 && url_path.compare(url_path.size() - 3, 3, ".gz") == 0 &&
+			index->entries.count(url_path.substr(0, url_path.size() - 3)) != 0;
+		if (!is_variant)
+			sorted[url_path] = &item.second;
+	}
+
+	// Entry table first, everything else appended to a data area after it
+	std::vector<BundleEntry> entries;
+	uint64_t data_offset = sizeof(BundleHeader) + sorted.size() * sizeof(BundleEntry);
+	std::string data;
+	auto append = [&](const std::string& bytes)
+	{
+		uint64_t offset = data_offset + data.size();
+		data += bytes;
+		return offset;
+	};
+	auto alignData = [&]()
+	{
+		while ((data_offset + data.size()) % 8 != 0)
+			data += '\0';
+	};
+
+	int variants = 0;
+	for (const auto& item : sorted)
+	{
+		const std::string& url_path = item.first;
+		const FileEntry& file = *item.second;
+
+		std::string body;
+		if (!readWholeFile(file.file_path, body))
+		{
+			std::cout << "Cannot read " << file.file_path << std::endl;
+			delete index;
+			return 1;
+		}
+		std::string etag = makeEtag(body);
+
+		auto gzip_entry = index->entries.find(url_path + ".gz");
+		bool has_variant = gzip_entry != index->entries.end();
+
+		BundleEntry entry;
+		std::memset(&entry, 0, sizeof(entry));
+
+		entry.path_offset = append(url_path);
+		entry.path_length = static_cast<uint32_t>(url_path.size());
+		entry.etag_offset = append(etag);
+		entry.etag_length = static_cast<uint32_t>(etag.size());
+
+		std::string head = makeHead(file, body.size(), etag, false, has_variant);
+		entry.head_offset = append(head);
+		entry.head_length = static_cast<uint32_t>(head.size());
+
+		alignData();
+		entry.body_offset = append(body);
+		entry.body_length = body.size();
+
+		if (has_variant)
+		{
+			std::string gzip_body;
+			if (!readWholeFile(gzip_entry->second.file_path, gzip_body))
+			{
+				std::cout << "Cannot read " << gzip_entry->second.file_path << std::endl;
+				delete index;
+				return 1;
+			}
+			std::string gzip_head = makeHead(file, gzip_body.size(), gzipEtag(etag), true, true);
+			entry.gzip_head_offset = append(gzip_head);
+			entry.gzip_head_length = static_cast<uint32_t>(gzip_head.size());
+
+			alignData();
+			entry.gzip_body_offset = append(gzip_body);
+			entry.gzip_body_length = gzip_body.size();
+			variants++;
+		}
+
+		entries.push_back(entry);
+	}
+
+	BundleHeader header;
+	std::memcpy(header.magic, BUNDLE_MAGIC, sizeof(header.magic));
+	header.version = BUNDLE_VERSION;
+	header.entry_count = static_cast<uint32_t>(entries.size());
+	header.entries_offset = sizeof(BundleHeader);
+	header.file_size = data_offset + data.size();
+
+	std::ofstream output(output_path, std::ios::binary);
+	if (!output.is_open())
+	{
+		std::cout << "Cannot write bundle: " << output_path << std::endl;
+		delete index;
+		return 1;
+	}
+
+	output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	output.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(BundleEntry));
+	output.write(data.data(), data.size());
+	output.close();
+
+	std::cout << "Packed " << entries.size() << " assets (" << variants << " with gzip variants) into "
+		<< output_path << " (" << header.file_size << " bytes)" << std::endl;
+
+	delete index;
+	return output ? 0 : 1;
+}
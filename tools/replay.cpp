@@ -0,0 +1,506 @@
+// http_replay - feed recorded request streams through the server pipeline
+//
+// Captures are either JSONL (one object per line):
+//   {"t_ms": 12.5, "request": "GET / HTTP/1.1\r\nHost: x\r\n\r\n", "expect": "HTTP/1.1 200 OK\r\n..."}
+// or raw HTTP dumps (requests back to back, as in messages.txt-style simulation files).
+//
+// In-process mode runs the server's per-request steps for a site directly (parseRequest ->
+// respondFromSite -> serializeResponse): virtual hosts, DELETE and Connection handling as
+// configured with --config. Proxy routes, live channels, PUT/POST uploads and rate limits
+// need a connection, so they are only exercised by --target, which sends the bytes to a
+// running server over loopback instead.
+// Recorded timing is honoured (scaled by --speed), latency is reported per request, and
+// responses are diffed against "expect" when the capture has one.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <memory>
+#include <cstdio>
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include "server.h"
+#include "request_parser.h"
+#include "response_builder.h"
+#include "file_handler.h"
+#include "connection_handler.h"
+#include "virtual_hosts.h"
+#include "config.h"
+#include "mime_types.h"
+
+struct CapturedRequest {
+	double t_ms;            // Offset from the start of the capture, -1 if unknown
+	std::string request;    // Raw request bytes
+	std::string expected;   // Expected raw response, empty if none recorded
+};
+
+struct ReplayOptions {
+	std::string capture_path;
+	std::string webroot = "webroot";
+	std::string config_path;     // Server config for in-process replay (sites, uploads, MIME types)
+	std::string target_host;     // Empty = in-process
+	int target_port = 0;
+	double speed = 1.0;          // 0 = no delays, 2 = twice as fast as recorded
+	std::string record_path;     // Write actual responses as a new capture
+	bool verbose = false;
+};
+
+// Decode one JSON string starting after its opening quote; pos ends after the closing quote
+static std::string parseJsonString(const std::string& line, size_t& pos)
+{
+	std::string out;
+	while (pos < line.length() && line[pos] != '"')
+	{
+		char c = line[pos++];
+		if (c != '\\' || pos >= line.length())
+		{
+			out += c;
+			continue;
+		}
+
+		char escape = line[pos++];
+		switch (escape)
+		{
+		case 'r': out += '\r'; break;
+		case 'n': out += '\n'; break;
+		case 't': out += '\t'; break;
+		case 'b': out += '\b'; break;
+		case 'f': out += '\f'; break;
+		case 'u':
+		{
+			unsigned int code = std::stoul(line.substr(pos, 4), nullptr, 16);
+			pos += 4;
+			// Captures are byte streams, so \u00XX maps straight to byte XX
+			if (code < 0x100)
+			{
+				out += static_cast<char>(code);
+			}
+			else if (code < 0x800)
+			{
+				out += static_cast<char>(0xC0 | (code >> 6));
+				out += static_cast<char>(0x80 | (code & 0x3F));
+			}
+			else
+			{
+				out += static_cast<char>(0xE0 | (code >> 12));
+				out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+				out += static_cast<char>(0x80 | (code & 0x3F));
+			}
+			break;
+		}
+		default: out += escape; break;
+		}
+	}
+	pos++; // Closing quote
+	return out;
+}
+
+// Parse a flat JSON object of string/number fields into a CapturedRequest
+static bool parseJsonLine(const std::string& line, CapturedRequest& captured)
+{
+	captured.t_ms = -1;
+	size_t pos = line.find('{');
+	if (pos == std::string::npos)
+		return false;
+	pos++;
+
+	while (true)
+	{
+		pos = line.find_first_not_of(" \t,", pos);
+		if (pos == std::string::npos || line[pos] == '}')
+			break;
+		if (line[pos] != '"')
+			return false;
+
+		pos++;
+		std::string key = parseJsonString(line, pos);
+		pos = line.find(':', pos);
+		if (pos == std::string::npos)
+			return false;
+		pos = line.find_first_not_of(" \t", pos + 1);
+		if (pos == std::string::npos)
+			return false;
+
+		if (line[pos] == '"')
+		{
+			pos++;
+			std::string value = parseJsonString(line, pos);
+			if (key == "request")
+				captured.request = value;
+			else if (key == "expect")
+				captured.expected = value;
+		}
+		else
+		{
+			size_t end = line.find_first_of(",}", pos);
+			std::string value = trim(line.substr(pos, end - pos));
+			if (key == "t_ms")
+				captured.t_ms = std::stod(value);
+			pos = end;
+		}
+	}
+
+	return !captured.request.empty();
+}
+
+static std::string escapeJson(const std::string& value)
+{
+	std::string out;
+	for (unsigned char c : value)
+	{
+		switch (c)
+		{
+		case '"': out += "\\\""; break;
+		case '\\': out += "\\\\"; break;
+		case '\r': out += "\\r"; break;
+		case '\n': out += "\\n"; break;
+		case '\t': out += "\\t"; break;
+		default:
+			if (c < 0x20 || c >= 0x80)
+			{
+				char buffer[8];
+				snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+				out += buffer;
+			}
+			else
+			{
+				out += static_cast<char>(c);
+			}
+		}
+	}
+	return out;
+}
+
+// Load a JSONL capture, or split a raw dump into requests using the server's own framing
+static std::vector<CapturedRequest> loadCapture(const std::string& path)
+{
+	std::vector<CapturedRequest> requests;
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+	{
+		std::cout << "[REPLAY] Cannot open capture: " << path << std::endl;
+		return requests;
+	}
+
+	std::stringstream contents;
+	contents << file.rdbuf();
+	std::string data = contents.str();
+
+	bool is_jsonl = path.size() >= 6 && path.compare(path.size() - 6, 6, ".jsonl") == 0;
+	if (is_jsonl)
+	{
+		std::istringstream lines(data);
+		std::string line;
+		int line_number = 0;
+		while (std::getline(lines, line))
+		{
+			line_number++;
+			if (trim(line).empty())
+				continue;
+
+			CapturedRequest captured;
+			try
+			{
+				if (parseJsonLine(line, captured))
+				{
+					requests.push_back(captured);
+					continue;
+				}
+			}
+			catch (const std::exception&)
+			{
+			}
+			std::cout << "[REPLAY] Skipping malformed line " << line_number << std::endl;
+		}
+		return requests;
+	}
+
+	// Raw dump: frame back-to-back requests; a trailing partial request is replayed as-is
+	while (!data.empty())
+	{
+		size_t request_end = findRequestEnd(data);
+		if (request_end == REQUEST_BAD_LENGTH || request_end == REQUEST_UNSUPPORTED_ENCODING)
+			request_end = findHeadEnd(data);   // The server refuses it after the head anyway
+		if (request_end == std::string::npos)
+			request_end = data.length();
+
+		requests.push_back({-1, data.substr(0, request_end), ""});
+		data.erase(0, request_end);
+	}
+	return requests;
+}
+
+// In-process: the same parse -> respond -> serialize steps handleClient uses for a site
+static std::string runInProcess(const std::string& raw_request, ServerContext& context)
+{
+	RequestData request = parseRequest(raw_request);
+	bool keep_alive = request.is_valid && wantsKeepAlive(request);
+	ResponseData response = respondFromSite(request, context, keep_alive);
+	return serializeResponse(response);
+}
+
+// Connect to the target server, INVALID_SOCKET on failure
+static SOCKET connectToTarget(const ReplayOptions& options)
+{
+	SOCKET sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (sock == INVALID_SOCKET)
+		return INVALID_SOCKET;
+
+	sockaddr_in addr = {};
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(options.target_port);
+	inet_pton(AF_INET, options.target_host.c_str(), &addr.sin_addr);
+
+	if (connect(sock, (const sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR)
+	{
+		closesocket(sock);
+		return INVALID_SOCKET;
+	}
+	return sock;
+}
+
+// Loopback: send the raw bytes and read one complete response (framed by Content-Length)
+static std::string runOverSocket(const std::string& raw_request, SOCKET& sock, const ReplayOptions& options)
+{
+	if (sock == INVALID_SOCKET)
+		sock = connectToTarget(options);
+	if (sock == INVALID_SOCKET)
+		return "";
+
+	if (sendData(sock, raw_request) < 0)
+	{
+		closeSocket(sock);
+		sock = INVALID_SOCKET;
+		return "";
+	}
+
+	std::string response;
+	while (true)
+	{
+		// Reuse the request framing: a response head has the same shape
+		// Chunked responses are compared by their head only
+		size_t response_end = findRequestEnd(response);
+		if (response_end == REQUEST_UNSUPPORTED_ENCODING || response_end == REQUEST_BAD_LENGTH)
+			response_end = findHeadEnd(response);
+		if (response_end != std::string::npos)
+		{
+			std::string complete = response.substr(0, response_end);
+			if (to_lowercase(complete).find("\r\nconnection: close") != std::string::npos)
+			{
+				closeSocket(sock);
+				sock = INVALID_SOCKET;
+			}
+			return complete;
+		}
+
+		if (receiveChunk(sock, response) <= 0)
+		{
+			closeSocket(sock);
+			sock = INVALID_SOCKET;
+			return response;
+		}
+	}
+}
+
+// First line where two responses differ, for the mismatch report
+static std::string firstDifference(const std::string& expected, const std::string& actual)
+{
+	std::istringstream expected_lines(expected);
+	std::istringstream actual_lines(actual);
+	std::string expected_line;
+	std::string actual_line;
+	int line_number = 1;
+
+	while (true)
+	{
+		bool has_expected = static_cast<bool>(std::getline(expected_lines, expected_line));
+		bool has_actual = static_cast<bool>(std::getline(actual_lines, actual_line));
+		if (!has_expected && !has_actual)
+			return "";
+		if (!has_expected || !has_actual || expected_line != actual_line)
+		{
+			return "line " + std::to_string(line_number) + ": expected '" + trim(expected_line) +
+				"' got '" + trim(actual_line) + "'";
+		}
+		line_number++;
+	}
+}
+
+static void printUsage()
+{
+	std::cout << "Usage: http_replay <capture.jsonl|raw-dump> [options]" << std::endl;
+	std::cout << "  --webroot DIR      webroot for in-process replay (default: webroot)" << std::endl;
+	std::cout << "  --config FILE      server config for in-process replay (virtual hosts, uploads)" << std::endl;
+	std::cout << "  --target HOST:PORT replay against a running server over TCP" << std::endl;
+	std::cout << "  --speed N          timing multiplier, 0 = no delays (default: 1)" << std::endl;
+	std::cout << "  --record FILE      write responses as a JSONL capture with \"expect\" set" << std::endl;
+	std::cout << "  --verbose          print every request, not only mismatches" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		printUsage();
+		return 1;
+	}
+
+	ReplayOptions options;
+	options.capture_path = argv[1];
+	for (int i = 2; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--webroot" && i + 1 < argc)
+			options.webroot = argv[++i];
+		else if (arg == "--config" && i + 1 < argc)
+			options.config_path = argv[++i];
+		else if (arg == "--speed" && i + 1 < argc)
+			options.speed = std::stod(argv[++i]);
+		else if (arg == "--record" && i + 1 < argc)
+			options.record_path = argv[++i];
+		else if (arg == "--verbose")
+			options.verbose = true;
+		else if (arg == "--target" && i + 1 < argc)
+		{
+			std::string target = argv[++i];
+			size_t colon_pos = target.find(':');
+			options.target_host = target.substr(0, colon_pos);
+			options.target_port = colon_pos == std::string::npos ? 8080 : std::stoi(target.substr(colon_pos + 1));
+		}
+		else
+		{
+			printUsage();
+			return 1;
+		}
+	}
+
+	std::vector<CapturedRequest> requests = loadCapture(options.capture_path);
+	if (requests.empty())
+	{
+		std::cout << "[REPLAY] No requests to replay" << std::endl;
+		return 1;
+	}
+
+	// Keep the server's per-request logging out of the report
+	std::streambuf* saved_cout = std::cout.rdbuf();
+	std::ostringstream server_log;
+
+	bool in_process = options.target_host.empty();
+	std::unique_ptr<VirtualHostTable> hosts;
+	ServerContext context = {nullptr, nullptr, nullptr};
+	SOCKET sock = INVALID_SOCKET;
+	if (in_process)
+	{
+		// Sites are set up the way main() does it
+		std::cout.rdbuf(server_log.rdbuf());
+		ServerConfig config;
+		if (!options.config_path.empty())
+			config = loadConfig(options.config_path);
+		if (!config.mime_types_file.empty())
+			loadMimeTypes(config.mime_types_file);
+		freezeMimeTypes();
+
+		std::vector<VirtualHostConfig> sites = config.virtual_hosts;
+		if (config.default_host.empty())
+			sites.push_back({"*", options.webroot, config.bundle_file});
+		hosts.reset(new VirtualHostTable(sites, config.default_host));
+		context.hosts = hosts.get();
+		context.uploads = config.uploads;
+		std::cout.rdbuf(saved_cout);
+
+		if (!config.proxy_routes.empty() || !config.live_prefix.empty() || config.uploads ||
+			config.rate_limit_requests > 0 || config.rate_limit_bytes > 0)
+		{
+			std::cout << "[REPLAY] Proxy routes, live channels, PUT/POST uploads and rate limits are not replayed in-process; use --target" << std::endl;
+		}
+	}
+	else
+	{
+		WSADATA wsaData;
+		WSAStartup(MAKEWORD(2, 2), &wsaData);
+	}
+
+	std::ofstream record;
+	if (!options.record_path.empty())
+		record.open(options.record_path, std::ios::binary);
+
+	std::vector<double> latencies_us;
+	int mismatches = 0;
+	int failures = 0;
+	auto replay_start = std::chrono::steady_clock::now();
+
+	for (size_t i = 0; i < requests.size(); i++)
+	{
+		const CapturedRequest& captured = requests[i];
+
+		// Wait until the recorded offset (scaled) has passed
+		if (options.speed > 0 && captured.t_ms >= 0)
+		{
+			auto due = replay_start + std::chrono::microseconds(static_cast<long long>(captured.t_ms * 1000.0 / options.speed));
+			std::this_thread::sleep_until(due);
+		}
+
+		std::cout.rdbuf(server_log.rdbuf());
+		auto start = std::chrono::steady_clock::now();
+		std::string response = in_process ? runInProcess(captured.request, context)
+			: runOverSocket(captured.request, sock, options);
+		auto end = std::chrono::steady_clock::now();
+		std::cout.rdbuf(saved_cout);
+		server_log.str("");
+
+		double latency_us = std::chrono::duration<double, std::micro>(end - start).count();
+		latencies_us.push_back(latency_us);
+
+		std::string request_line = captured.request.substr(0, captured.request.find("\r\n"));
+		std::string status_line = response.substr(0, response.find("\r\n"));
+		if (response.empty())
+		{
+			failures++;
+			status_line = "(no response)";
+		}
+
+		std::string difference;
+		if (!captured.expected.empty())
+			difference = firstDifference(captured.expected, response);
+		if (!difference.empty())
+			mismatches++;
+
+		if (options.verbose || !difference.empty() || response.empty())
+		{
+			std::cout << "#" << i + 1 << " " << request_line << " -> " << status_line
+				<< " (" << static_cast<long long>(latency_us) << " us)";
+			if (!difference.empty())
+				std::cout << " DIFF " << difference;
+			std::cout << std::endl;
+		}
+
+		if (record.is_open())
+		{
+			double t_ms = captured.t_ms >= 0 ? captured.t_ms : 0;
+			record << "{\"t_ms\": " << t_ms << ", \"request\": \"" << escapeJson(captured.request)
+				<< "\", \"expect\": \"" << escapeJson(response) << "\"}\n";
+		}
+	}
+
+	if (sock != INVALID_SOCKET)
+		closesocket(sock);
+
+	// Summary: latency percentiles over all replayed requests
+	std::sort(latencies_us.begin(), latencies_us.end());
+	auto percentile = [&](double p)
+	{
+		return static_cast<long long>(latencies_us[static_cast<size_t>(p * (latencies_us.size() - 1))]);
+	};
+
+	std::cout << "[REPLAY] " << requests.size() << " requests " << (in_process ? "in-process" : "over TCP")
+		<< ", " << mismatches << " mismatched, " << failures << " without response" << std::endl;
+	std::cout << "[REPLAY] latency us: p50=" << percentile(0.50) << " p90=" << percentile(0.90)
+		<< " p99=" << percentile(0.99) << " max=" << static_cast<long long>(latencies_us.back()) << std::endl;
+
+	return (mismatches == 0 && failures == 0) ? 0 : 2;
+}